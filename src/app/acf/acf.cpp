@@ -274,6 +274,7 @@ int gauze_main(int argc, char** argv)
         if (!acf)
         {
             acf = std::make_shared<acf::Detector>(sModel);
+            acf->setIsBGR(true); // ingest BGR(A) frames directly (no cvtColor)
         }
 
         if (acf.get() && acf->good())
@@ -331,17 +332,31 @@ int gauze_main(int argc, char** argv)
 
             if (!image.empty())
             {
-                cv::Mat imageRGB;
+                cv::Mat imageRGB; // or BGR(A) if the detector supports it directly
                 switch (image.channels())
                 {
                 case 1:
                     cv::cvtColor(image, imageRGB, cv::COLOR_GRAY2RGB);
                     break;
                 case 3:
-                    cv::cvtColor(image, imageRGB, cv::COLOR_BGR2RGB);
+                    if (detector->getIsBGR())
+                    {
+                        imageRGB = image;
+                    }
+                    else
+                    {
+                        cv::cvtColor(image, imageRGB, cv::COLOR_BGR2RGB);
+                    }
                     break;
                 case 4:
-                    cv::cvtColor(image, imageRGB, cv::COLOR_BGRA2RGB);
+                    if (detector->getIsBGR())
+                    {
+                        imageRGB = image;
+                    }
+                    else
+                    {
+                        cv::cvtColor(image, imageRGB, cv::COLOR_BGRA2RGB);
+                    }
                     break;
                 }
 
@@ -10,3 +10,4 @@ option(ACF_OPENGL_ES2 "Use OpenGL ES 2.0 (and compatible)" OFF)
 option(ACF_OPENGL_ES3 "Use OpenGL ES 3.0 (and compatible)" OFF)
 option(ACF_HAS_GPU "Drishti has GPU" ON)
 option(ACF_USE_EGL "Use EGL context" OFF)
+set(ACF_SIMD_WIDTH "0" CACHE STRING "Cap the toolbox SIMD width in floats: 0 (widest supported), 4 (SSE/NEON), 8 (AVX2), 16 (AVX-512)")
@@ -14,17 +14,23 @@
 #include <acf/ACFIO.h>
 #include <acf/acf_common.h>
 #include <acf/acf_export.h>
-#include <acf/random.h>
+#include <acf/tasks.h> // private
 
 #include <opencv2/core/base.hpp>
 #include <opencv2/core/hal/interface.h>
 
+#include <algorithm>
 #include <iomanip>
+#include <tuple>
 
 namespace acf {
 template <typename T> struct Field;
 }  // namespace acf
 
+void rgbConvertInterleavedMex(const cv::Mat& I, MatP& J, int flag, bool isBGR, bool transpose);
+int getSimdWidth();
+void setSimdWidth(int width);
+
 ACF_NAMESPACE_BEGIN
 
 ////////////////////////////////////////////////////////
@@ -120,13 +126,31 @@ cv::Mat cvt8UC3To32FC3(const cv::Mat& I)
     return If;
 }
 
-float Detector::evaluate(const cv::Mat& I) const
+// Convert an 8 bit color image (see setIsBGR()) to transposed planar float format in a single pass:
+bool Detector::ingest(const cv::Mat& I, MatP& Ip, bool doLuv) const
 {
-    cv::Mat It = m_isTranspose ? I : I.t();
-    cv::Mat Itf = (It.depth() == CV_32F) ? It : cvt8UC3To32FC3(It);
+    if ((I.depth() != CV_8U) || ((I.channels() != 3) && (I.channels() != 4)))
+    {
+        return false;
+    }
 
-    MatP Ip;
-    computeChannels(Itf, Ip);
+    rgbConvertInterleavedMex(I, Ip, doLuv ? 2 : 1, m_isBGR, !m_isTranspose);
+    return true;
+}
+
+float Detector::evaluate(const cv::Mat& I) const
+{
+    MatP Irgb, Ip;
+    if (ingest(I, Irgb, false))
+    {
+        computeChannels(Irgb, Ip);
+    }
+    else
+    {
+        cv::Mat It = m_isTranspose ? I : I.t();
+        cv::Mat Itf = (It.depth() == CV_32F) ? It : cvt8UC3To32FC3(It);
+        computeChannels(Itf, Ip);
+    }
 
     auto& pPyramid = *(opts.pPyramid);
     return evaluate(Ip, *(pPyramid.pChns->shrink), *(opts.modelDsPad), *(opts.stride));
@@ -134,10 +158,137 @@ float Detector::evaluate(const cv::Mat& I) const
 
 int Detector::operator()(const cv::Mat& I, std::vector<cv::Rect>& objects, std::vector<double>* scores)
 {
-    cv::Mat It = m_isTranspose ? I : I.t();
-    cv::Mat Itf = (It.depth() == CV_32F) ? It : cvt8UC3To32FC3(It);
-    MatP Ip(Itf);
-    return (*this)(Ip, objects, scores);
+    Pyramid P;
+    if (m_doStreaming || (m_timeBudget > 0.0))
+    {
+        DetectionVec bbs;
+        beginDetection();
+        computePyramid(I, P, [&](const Pyramid& P, const std::vector<int>& levels) {
+            logPyramid(P);
+            detectPyramid(P, bbs);
+        });
+        return finishDetections(bbs, objects, scores);
+    }
+
+    computePyramid(I, P);
+    logPyramid(P);
+    return (*this)(P, objects, scores);
+}
+
+int Detector::operator()(const cv::Mat& I, const SearchRegionVec& regions, std::vector<cv::Rect>& objects, std::vector<double>* scores)
+{
+    // Full frame scales (see detectPyramid() for the transposed object size), with the frame
+    // in the orientation of the pyramid input (see ingest()):
+    const cv::Size size = m_isTranspose ? cv::Size(I.rows, I.cols) : I.size();
+    const cv::Size frame(size.height, size.width);
+    const cv::Rect bounds({ 0, 0 }, size);
+    const auto& pPyramid = *(opts.pPyramid);
+    const cv::Size modelDs = *(opts.modelDs), modelDsPad = *(opts.modelDsPad);
+    RealVec scales;
+    Size2dVec scaleshw;
+    getScales(*(pPyramid.nPerOct), *(pPyramid.nOctUp), *(pPyramid.minDs), *(pPyramid.pChns->shrink), frame, scales, scaleshw);
+
+    double minScale = 0.0, maxScale = 0.0;
+    getScaleRange(minScale, maxScale);
+
+    // Expand each region by the context needed for the largest window in range, and merge
+    // overlapping expansions into covering tiles that share one pyramid:
+    struct Tile
+    {
+        cv::Rect crop;
+        PyramidFrame range;
+        std::vector<const SearchRegion*> regions;
+    };
+    std::vector<Tile> tiles;
+    for (const auto& region : regions)
+    {
+        const cv::Rect roi = region.roi & bounds;
+        Tile tile;
+        tile.range.size = frame;
+        tile.range.minScale = std::numeric_limits<double>::max();
+        tile.range.maxScale = 0.0;
+        tile.regions = { &region };
+        for (const auto& s : scales)
+        {
+            const double width = cv::Size(cv::Size2d(modelDs) / s).height;
+            if ((width >= region.minWidth) && (width <= region.maxWidth) && (s >= minScale) && (s <= maxScale))
+            {
+                tile.range.minScale = std::min(tile.range.minScale, s);
+                tile.range.maxScale = std::max(tile.range.maxScale, s);
+            }
+        }
+        if ((tile.range.minScale > tile.range.maxScale) || roi.empty())
+        {
+            continue;
+        }
+
+        const int margin = int(std::ceil(double(std::max(modelDsPad.width, modelDsPad.height)) / tile.range.minScale));
+        tile.crop = cv::Rect(roi.x - margin, roi.y - margin, roi.width + margin * 2, roi.height + margin * 2) & bounds;
+        tiles.push_back(tile);
+    }
+
+    for (bool isMerged = true; isMerged;)
+    {
+        isMerged = false;
+        for (int i = 0; (i < tiles.size()) && !isMerged; i++)
+        {
+            for (int j = i + 1; (j < tiles.size()) && !isMerged; j++)
+            {
+                auto &a = tiles[i], &b = tiles[j];
+                if ((a.crop & b.crop).area())
+                {
+                    a.crop |= b.crop;
+                    a.range.minScale = std::min(a.range.minScale, b.range.minScale);
+                    a.range.maxScale = std::max(a.range.maxScale, b.range.maxScale);
+                    std::copy(b.regions.begin(), b.regions.end(), std::back_inserter(a.regions));
+                    tiles.erase(tiles.begin() + j);
+                    isMerged = true;
+                }
+            }
+        }
+    }
+
+    DetectionVec bbs;
+    beginDetection();
+    for (const auto& tile : tiles)
+    {
+        const cv::Rect& crop = tile.crop;
+        cv::Mat Ic = I(m_isTranspose ? cv::Rect(crop.y, crop.x, crop.height, crop.width) : crop);
+        if (!Ic.isContinuous())
+        {
+            Ic = Ic.clone();
+        }
+
+        Pyramid P;
+        computePyramid(Ic, P, {}, &tile.range);
+        logPyramid(P);
+
+        DetectionVec bbs1;
+        for (const auto& region : tile.regions)
+        {
+            SearchRegion local = *region;
+            local.roi = (region->roi & bounds) - crop.tl();
+            detectPyramid(P, bbs1, &local);
+        }
+
+        // Windows in more than one region of the tile are only reported once:
+        if (tile.regions.size() > 1)
+        {
+            const auto key = [](const Detection& bb) {
+                return std::make_tuple(bb.roi.x, bb.roi.y, bb.roi.width, bb.roi.height, bb.score);
+            };
+            std::sort(bbs1.begin(), bbs1.end(), [&](const Detection& a, const Detection& b) { return key(a) < key(b); });
+            bbs1.erase(std::unique(bbs1.begin(), bbs1.end(), [&](const Detection& a, const Detection& b) { return key(a) == key(b); }), bbs1.end());
+        }
+
+        for (auto& bb : bbs1)
+        {
+            bb.roi += crop.tl();
+        }
+        std::copy(bbs1.begin(), bbs1.end(), std::back_inserter(bbs));
+    }
+
+    return finishDetections(bbs, objects, scores);
 }
 
 /*
@@ -146,16 +297,39 @@ int Detector::operator()(const cv::Mat& I, std::vector<cv::Rect>& objects, std::
 
 void Detector::computePyramid(const cv::Mat& I, Pyramid& P)
 {
-    cv::Mat It = m_isTranspose ? I : I.t();
-    cv::Mat Itf = (It.depth() == CV_32F) ? It : cvt8UC3To32FC3(It);
-    MatP Ip(Itf);
-    computePyramid(Ip, P);
+    computePyramid(I, P, {});
+}
+
+void Detector::computePyramid(const cv::Mat& I, Pyramid& P, const PyramidSink& sink, const PyramidFrame* frame)
+{
+    // Convert 8 bit input directly to luv when the model expects it:
+    auto pPyramid = opts.pPyramid.get();
+    const std::string& cs = pPyramid.pChns->pColor->colorSpace;
+    const bool doLuv = !m_isLuv && ((cs == "luv") || (cs == "LUV"));
+
+    MatP Ip;
+    if (ingest(I, Ip, doLuv))
+    {
+        pPyramid.pChns->isLuv = doLuv;
+        chnsPyramid(Ip, &pPyramid, P, true, {}, &m_workspace, sink, frame);
+    }
+    else
+    {
+        cv::Mat It = m_isTranspose ? I : I.t();
+        cv::Mat Itf = (It.depth() == CV_32F) ? It : cvt8UC3To32FC3(It);
+        computePyramid(MatP(Itf), P, sink, frame);
+    }
 }
 
 void Detector::computePyramid(const MatP& Ip, Pyramid& P)
+{
+    computePyramid(Ip, P, {});
+}
+
+void Detector::computePyramid(const MatP& Ip, Pyramid& P, const PyramidSink& sink, const PyramidFrame* frame)
 {
     CV_Assert(Ip[0].depth() == CV_32F);
-    chnsPyramid(Ip, &opts.pPyramid.get(), P, true);
+    chnsPyramid(Ip, &opts.pPyramid.get(), P, true, {}, &m_workspace, sink, frame);
 }
 
 /*
@@ -239,6 +413,16 @@ void Detector::computeChannels(const MatP& Ip, MatP& Ip2, const MatLoggerType& p
     fuseChannels(chns.data.begin(), chns.data.end(), Ip2);
 }
 
+void Detector::setSimdWidth(int width)
+{
+    ::setSimdWidth(width);
+}
+
+int Detector::getSimdWidth()
+{
+    return ::getSimdWidth();
+}
+
 /*
  * Input is transposed planar format image: LUVMO
  */
@@ -247,25 +431,57 @@ int Detector::operator()(const MatP& IpTranspose, std::vector<cv::Rect>& objects
 {
     // Create features:
     Pyramid P;
-    chnsPyramid(IpTranspose, &opts.pPyramid.get(), P, true);
+    if (m_doStreaming || (m_timeBudget > 0.0))
+    {
+        DetectionVec bbs;
+        beginDetection();
+        chnsPyramid(IpTranspose, &opts.pPyramid.get(), P, true, {}, &m_workspace, [&](const Pyramid& P, const std::vector<int>& levels) {
+            logPyramid(P);
+            detectPyramid(P, bbs);
+        });
+        return finishDetections(bbs, objects, scores);
+    }
+
+    chnsPyramid(IpTranspose, &opts.pPyramid.get(), P, true, {}, &m_workspace);
+    logPyramid(P);
+    return (*this)(P, objects, scores);
+}
 
+void Detector::logPyramid(const Pyramid& P) const
+{
     if (m_logger)
     {
         for (int i = 0; i < P.nScales; i++)
         {
+            if (P.data[i].empty())
+            {
+                continue; // not populated (see PyramidSink)
+            }
+
             std::stringstream ss;
             ss << std::setfill('0') << std::setw(6) << i;
             cv::Mat d = P.data[i][0].base().clone().t(), canvas;
+            if (d.depth() == CV_16F)
+            {
+                d.convertTo(d, CV_32F); // see setDoHalf()
+            }
             cv::normalize(d, canvas, 0, 255, cv::NORM_MINMAX, CV_8UC1);
             m_logger(canvas, ss.str());
         }
     }
-
-    return (*this)(P, objects, scores);
 }
 
 // Multiscale search:
 int Detector::operator()(const Pyramid& P, std::vector<cv::Rect>& objects, std::vector<double>* scores)
+{
+    DetectionVec bbs;
+    beginDetection();
+    detectPyramid(P, bbs);
+    return finishDetections(bbs, objects, scores);
+}
+
+// Scan the populated levels of a pyramid and append detections in image coordinates:
+void Detector::detectPyramid(const Pyramid& P, DetectionVec& bbs, const SearchRegion* region)
 {
     auto& pPyramid = *(opts.pPyramid);
     auto shrink = *(pPyramid.pChns->shrink);
@@ -273,61 +489,157 @@ int Detector::operator()(const Pyramid& P, std::vector<cv::Rect>& objects, std::
     auto modelDsPad = *(opts.modelDsPad);
     auto modelDs = *(opts.modelDs);
     auto shift = (modelDsPad - modelDs) / 2 - pad;
+    auto stride = *(opts.stride);
 
-    // Here we create random indices so that (on average) for each `const cv::Range &r` slice
-    // in the cv::parallel_for_(const cv::Range &r, ...) call, the total ACF Pyramid area
-    // for all levels (specified by Range::{start,end}) will be equal for every thread.
-    auto scales = acf::create_random_indices(P.nScales);
-    std::vector<DetectionVec> bbs_(P.nScales);
-
-    std::function<void(const cv::Range& r)> worker = [&](const cv::Range& r)
+    // Windows (in scan coordinates) with centers in the search region, by inverting the
+    // mapping to image coordinates below, for levels with objects in the size range:
+    RectVec windows;
+    const bool isBounded = (m_minObjectSize != cv::Size()) || (m_maxObjectSize != cv::Size());
+    if (region || isBounded)
     {
-        for (int j = r.start; j < r.end; j++)
+        windows.resize(P.nScales);
+        for (int i = 0; i < P.nScales; i++)
         {
-            int i = scales[j];
-
-            DetectionVec ds;
-
-            // ROI fields indicates row major storage, else column major:
-            if (P.rois.size() > i)
+            cv::Size size(cv::Size2d(modelDs) / P.scales[i]); // transposed
+            if (!isObjectSizeInRange({ size.height, size.width }))
             {
-                acfDetect1(P.data[i][0], P.rois[i], shrink, modelDsPad, *(opts.stride), *(opts.cascThr), ds);
+                continue;
             }
-            else
+
+            if (!region)
             {
-                acfDetect1(P.data[i][0], {}, shrink, modelDsPad, *(opts.stride), *(opts.cascThr), ds);
+                windows[i] = cv::Rect(0, 0, std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
+                continue;
             }
 
-            // Scale up the detections
-            for (auto& bb : ds)
+            if ((size.height < region->minWidth) || (size.height > region->maxWidth))
             {
-                cv::Size size(cv::Size2d(modelDs) / P.scales[i]);
-                bb.roi.x = double(bb.roi.x + shift.width) / P.scaleshw[i].width;
-                bb.roi.y = double(bb.roi.y + shift.height) / P.scaleshw[i].height;
-                bb.roi.width = size.width;
-                bb.roi.height = size.height;
-
-                std::swap(bb.roi.x, bb.roi.y);
-                std::swap(bb.roi.width, bb.roi.height);
+                continue;
             }
-            std::copy(ds.begin(), ds.end(), std::back_inserter(bbs_[i]));
+
+            const auto& roi = region->roi;
+
+            const auto& shw = P.scaleshw[i];
+            const int c0 = int(std::ceil(((roi.x - size.height * 0.5) * shw.height - shift.height) / stride));
+            const int c1 = int(std::ceil(((roi.br().x - size.height * 0.5) * shw.height - shift.height) / stride));
+            const int r0 = int(std::ceil(((roi.y - size.width * 0.5) * shw.width - shift.width) / stride));
+            const int r1 = int(std::ceil(((roi.br().y - size.width * 0.5) * shw.width - shift.width) / stride));
+            windows[i] = cv::Rect(c0, r0, std::max(c1 - c0, 0), std::max(r1 - r0, 0));
         }
-    };
+    }
+
+    // Scan all levels (in parallel tiles):
+    std::vector<DetectionVec> bbs_;
+    acfDetectPyramid(P, shrink, modelDsPad, stride, *(opts.cascThr), bbs_, windows.empty() ? nullptr : &windows);
 
-    if (m_doParallel)
+    // Local nms only applies to overlap based types (see setDoLocalNms()):
+    const std::string type = opts.pNms->type.has ? opts.pNms->type.get() : std::string("max");
+    const bool doLocalNms = m_doNms && m_doLocalNms && ((type == "max") || (type == "maxg"));
+
+    // Scale up the detections (and run the local nms) one level per task:
+    std::vector<double> costs(bbs_.size());
+    for (int i = 0; i < bbs_.size(); i++)
     {
-        cv::parallel_for_({ 0, P.nScales }, worker);
+        costs[i] = static_cast<double>(bbs_[i].size());
     }
-    else
+
+    TaskScheduler scheduler("nms");
+    scheduler.run(costs, [&](int i) {
+        cv::Size size(cv::Size2d(modelDs) / P.scales[i]);
+        for (auto& bb : bbs_[i])
+        {
+            bb.roi.x = double(bb.roi.x + shift.width) / P.scaleshw[i].width;
+            bb.roi.y = double(bb.roi.y + shift.height) / P.scaleshw[i].height;
+            bb.roi.width = size.width;
+            bb.roi.height = size.height;
+
+            std::swap(bb.roi.x, bb.roi.y);
+            std::swap(bb.roi.width, bb.roi.height);
+        }
+
+        if (doLocalNms && (bbs_[i].size() > 1))
+        {
+            DetectionVec bbOut;
+            bbNms(bbs_[i], opts.pNms, bbOut);
+            bbs_[i].swap(bbOut);
+        }
+    }, m_doParallel);
+    const auto& timings = scheduler.timings();
+    std::copy(timings.begin(), timings.end(), std::back_inserter(m_detectionTimings));
+
+    std::size_t n = bbs.size();
+    for (const auto& level : bbs_)
+    {
+        n += level.size();
+    }
+    bbs.reserve(n);
+    for (const auto& level : bbs_)
     {
-        worker({ 0, P.nScales });
+        std::copy(level.begin(), level.end(), std::back_inserter(bbs));
     }
+}
+
+// Object size at scale s is modelDs/s (transposed, see detectPyramid()), so the minimum
+// object size bounds the largest scale and the maximum object size bounds the smallest:
+void Detector::getScaleRange(double& minScale, double& maxScale) const
+{
+    minScale = 0.0;
+    maxScale = std::numeric_limits<double>::max();
 
-    for (int i = 1; i < bbs_.size(); i++)
+    const cv::Size modelDs = opts.modelDs.has ? *(opts.modelDs) : cv::Size();
+    if (!modelDs.area())
     {
-        std::copy(bbs_[i].begin(), bbs_[i].end(), std::back_inserter(bbs_[0]));
+        return;
     }
-    auto& bbs = bbs_[0];
+
+    if (m_minObjectSize.width > 0)
+    {
+        maxScale = std::min(maxScale, double(modelDs.height) / m_minObjectSize.width);
+    }
+    if (m_minObjectSize.height > 0)
+    {
+        maxScale = std::min(maxScale, double(modelDs.width) / m_minObjectSize.height);
+    }
+    if (m_maxObjectSize.width > 0)
+    {
+        minScale = std::max(minScale, double(modelDs.height) / (m_maxObjectSize.width + 1));
+    }
+    if (m_maxObjectSize.height > 0)
+    {
+        minScale = std::max(minScale, double(modelDs.width) / (m_maxObjectSize.height + 1));
+    }
+}
+
+bool Detector::isObjectSizeInRange(const cv::Size& size) const
+{
+    return (size.width >= m_minObjectSize.width) && (size.height >= m_minObjectSize.height) && //
+        ((m_maxObjectSize.width <= 0) || (size.width <= m_maxObjectSize.width)) && //
+        ((m_maxObjectSize.height <= 0) || (size.height <= m_maxObjectSize.height));
+}
+
+// Reset the per call statistics and start the time budget (see setTimeBudget()):
+void Detector::beginDetection()
+{
+    m_detectionTimings.clear();
+    m_windowCount = 0;
+    m_skippedScales.clear();
+    m_deadline = std::chrono::steady_clock::time_point::max();
+    if (m_timeBudget > 0.0)
+    {
+        const std::chrono::duration<double> budget(m_timeBudget);
+        m_deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(budget);
+    }
+}
+
+bool Detector::isPastDeadline() const
+{
+    return (m_timeBudget > 0.0) && (std::chrono::steady_clock::now() >= m_deadline);
+}
+
+// Non maximal suppression and pruning of raw detections:
+int Detector::finishDetections(DetectionVec& bbs, std::vector<cv::Rect>& objects, std::vector<double>* scores)
+{
+    m_deadline = std::chrono::steady_clock::time_point::max(); // end of the detection call
 
     if (m_doNms)
     {
@@ -29,9 +29,11 @@
 #include <spdlog/spdlog.h>
 
 #include <cassert>
+#include <chrono>
 #include <cstdio>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <utility>
 
@@ -39,11 +41,14 @@ namespace spdlog {
 class logger;
 }  // namespace spdlog
 
+struct ImResampleCoef; // see imResample()
+
 ACF_NAMESPACE_BEGIN
 
 class DetectionParams;
 // Forward declarations:
 class DetectionSink;
+class ChannelIndexCache;
 template <class _T>
 struct ParserNode;
 
@@ -67,8 +72,8 @@ public:
 
     struct ACF_EXPORT Options
     {
-        //   .type       - ['max'] 'max', 'maxg', 'ms', 'cover', or 'none'
-        //   .thr        - [-inf] threshold below which to discard (0 for 'ms')
+        //   .type       - ['max'] 'max', 'maxg', 'ms', 'cover', 'soft', 'softg' or 'none'
+        //   .thr        - [-inf] threshold below which to discard (0 for 'ms', cascThr for 'soft')
         //   .maxn       - [inf] if n>maxn split and run recursively (see above)
         //   .radii      - [.15 .15 1 1] supression radii ('ms' only, see above)
         //   .overlap    - [.5] area of overlap for bbs
@@ -174,6 +179,11 @@ public:
                 // to specify this at run time with the following field.
                 bool isLuv = false;
 
+                // Compute the color, gradient magnitude and gradient histogram channels in
+                // column bands that stay in cache (see chnsFused()) when the parameters allow
+                // it.  The result is identical to the separate full image passes.
+                bool doFused = true;
+
                 void merge(const Chns& src, int mode);
                 friend std::ostream& operator<<(std::ostream& os, const Chns& src);
 
@@ -305,6 +315,13 @@ public:
         cv::Mat thrsU8; // prescaled threshold (x255) for uint8_t input
         const cv::Mat& getScaledThresholds(int type) const;
 
+        // Interleaved per node records (feature, threshold, leaf, child) for the scan,
+        // one table for float and one for uint8_t input, rebuilt whenever the trees change.
+        cv::Mat nodes;
+        cv::Mat nodesU8;
+        void compile();
+        const cv::Mat& getCompiledNodes(int type) const;
+
         template <class Archive>
         void serialize(Archive& ar, const uint32_t version);
     };
@@ -338,6 +355,8 @@ public:
         std::vector<Info> info;
     };
 
+    // The planes already in chns (from a previous call) are reused for the output channels
+    // when they have the same geometry and nothing else references them.
     // clang-format off
     static int chnsCompute
     (
@@ -388,6 +407,92 @@ public:
         }
     };
 
+    // Per task record of a scheduled stage (see getPyramidWorkspace(), getDetectionTimings()):
+    struct ACF_EXPORT TaskTiming
+    {
+        const char* stage = nullptr; // stage name
+        int task = 0;                // task index within the stage (e.g., level)
+        int worker = 0;              // logical worker that ran the task
+        double cost = 0.0;           // estimated cost
+        double seconds = 0.0;        // measured run time
+    };
+
+    // Frame invariant pyramid layout for a fixed input size and Options::Pyramid: the scales,
+    // real/approximated scale maps, level geometry and imResample() coefficient tables.  It
+    // is built by chnsPyramid() when the input size or parameters change and reused otherwise
+    // (see PyramidWorkspace::plan), so per frame setup (getScales() etc) is skipped for video.
+    struct ACF_EXPORT PyramidPlan
+    {
+        // Plan key:
+        cv::Size size; // input image size
+        int nPerOct = 0;
+        int nOctUp = 0;
+        int nApprox = 0;
+        int shrink = 0;
+        cv::Size minDs;
+        cv::Size pad;
+        double minScale = 0.0; // see getScaleRange()
+        double maxScale = std::numeric_limits<double>::max();
+        cv::Size frame; // size the scales are selected for if not the input (see PyramidFrame)
+
+        RealVec scales;
+        Size2dVec scaleshw;
+        std::vector<int> isR, isA, isN; // real scales, approximated scales, nearest real scale (1 based)
+        std::vector<std::vector<int>> groups; // [ REAL SCALES ] levels (0 based) computed from each real scale
+        cv::Point border;               // channel padding along L/R (x) and T/B (y)
+
+        std::vector<int> imageSource;      // [ REAL SCALES ] resampling source: input (-1) or real scale index
+        std::vector<cv::Size> imageSizes;  // [ REAL SCALES ] resampled image size
+        std::vector<cv::Size> chnsSizes;   // [ LEVELS ] channel size before padding
+        std::vector<cv::Size> paddedSizes; // [ LEVELS ] output channel size
+
+        std::vector<std::shared_ptr<ImResampleCoef>> imageCoef; // [ REAL SCALES ] image resampling (null if unused)
+        std::vector<std::shared_ptr<ImResampleCoef>> chnsCoef;  // [ LEVELS ] nearest real -> approximated channels
+
+        bool matches(const cv::Size& size_, int nPerOct_, int nOctUp_, int nApprox_, const cv::Size& minDs_, int shrink_, const cv::Size& pad_, double minScale_, double maxScale_, const cv::Size& frame_) const
+        {
+            return (size == size_) && (nPerOct == nPerOct_) && (nOctUp == nOctUp_) && (nApprox == nApprox_) && (minDs == minDs_) && (shrink == shrink_) && (pad == pad_) && (minScale == minScale_) && (maxScale == maxScale_) && (frame == frame_);
+        }
+    };
+
+    // Scale selection for a pyramid computed over a tile of a larger frame (see operator()
+    // with search regions): the levels are the nominal scales of a full frame search, in
+    // the same order and count, restricted to [minScale, maxScale] instead of the range
+    // from getScaleRange().  Only the level geometry (scaleshw etc) follows the tile.
+    struct ACF_EXPORT PyramidFrame
+    {
+        cv::Size size; // full frame size, in the orientation of the pyramid input
+        double minScale = 0.0;
+        double maxScale = std::numeric_limits<double>::max();
+    };
+
+    // Storage reused by chnsPyramid() across calls (frames).  Buffers are only (re)allocated
+    // when the input geometry changes, or when a buffer is still referenced by a Pyramid
+    // returned from a previous call, so a video stream at a fixed resolution runs with no
+    // pyramid allocations in steady state.  The channels at the real scales are computed
+    // into the planes of the previous call (see chnsCompute()), and any plane chnsCompute()
+    // allocates instead is counted.  Scratch temporaries come from the toolbox arena.
+    struct ACF_EXPORT PyramidWorkspace
+    {
+        std::vector<MatP> resampled;          // [ REAL SCALES ] resampled input images
+        std::vector<Channels> real;           // [ REAL SCALES ] channels from chnsCompute()
+        std::vector<std::vector<MatP>> chns;  // [ LEVELS x TYPES ] approximated channels
+        std::vector<std::vector<MatP>> padded; // [ LEVELS x TYPES ] padded channels (concat == 0)
+        std::vector<MatP> fused;              // [ LEVELS ] concatenated channels (concat == 1)
+        PyramidPlan plan;                     // layout for the current input size
+
+        std::size_t allocations = 0; // buffer (re)allocations in the last call
+        std::size_t bytes = 0;       // bytes (re)allocated in the last call
+        std::size_t plans = 0;       // plans built in the last call (0 if reused)
+
+        std::vector<TaskTiming> timings; // scheduled stages of the last call
+    };
+
+    // Receives each group of levels of a streamed pyramid as soon as it is complete (see
+    // chnsPyramid()).  P has the full layout (scales etc) but only P.data[i] for i in levels
+    // is populated, and those buffers are recycled once the sink returns.
+    using PyramidSink = std::function<void(const Pyramid& P, const std::vector<int>& levels)>;
+
     // This contains the subset of parameters that are permitted to be overriden in acfModify
     struct ACF_EXPORT Modify
     {
@@ -420,12 +525,42 @@ public:
     static void computeChannels(const MatP& Ip, MatP& Ip2, const MatLoggerType& pLlogger = {});
 
     // (((((((( Detection ))))))))
+    // A Detector holds per call state (the pyramid workspace, timings, window count, skipped
+    // scales and time budget deadline), so detection and computePyramid() calls on the same
+    // Detector are not reentrant and must not run concurrently: use one Detector (or copy)
+    // per thread.  Only the channel index cache is mutex guarded, for the parallel scans
+    // within a call.
     int operator()(const cv::Mat& I, RectVec& objects, RealVec* scores = nullptr) override;
     int operator()(const MatP& I, RectVec& objects, RealVec* scores = nullptr) override;
 
     // Multiscale search:
     virtual int operator()(const Pyramid& P, RectVec& objects, RealVec* scores = nullptr);
 
+    // Search region in input image coordinates: only windows whose centers fall inside roi
+    // and whose object width is in [minWidth, maxWidth] are scanned.
+    struct ACF_EXPORT SearchRegion
+    {
+        SearchRegion() = default;
+        SearchRegion(const cv::Rect& roi, double minWidth = 0.0, double maxWidth = std::numeric_limits<double>::max())
+            : roi(roi)
+            , minWidth(minWidth)
+            , maxWidth(maxWidth)
+        {
+        }
+        cv::Rect roi;
+        double minWidth = 0.0;
+        double maxWidth = std::numeric_limits<double>::max();
+    };
+    using SearchRegionVec = std::vector<SearchRegion>;
+
+    // Region restricted search: each region is expanded by enough context for the largest
+    // window in range, overlapping expansions are merged into shared covering tiles, and the
+    // channels of each tile are computed once at the nominal scales of a full frame search
+    // (see PyramidFrame), for the object widths of its regions only.  Only the windows in
+    // each region are scanned, and detections from all regions are merged before non
+    // maximal suppression.
+    int operator()(const cv::Mat& I, const SearchRegionVec& regions, RectVec& objects, RealVec* scores = nullptr);
+
     // clang-format off
     int chnsPyramid
     (
@@ -433,7 +568,10 @@ public:
         const Options::Pyramid* pPyramid,
         Pyramid& pyramid,
         bool isInit = false,
-        const MatLoggerType& pLogger = {}
+        const MatLoggerType& pLogger = {},
+        PyramidWorkspace* workspace = nullptr,
+        const PyramidSink& sink = {},
+        const PyramidFrame* frame = nullptr
     );
     // clang-format on
 
@@ -457,12 +595,21 @@ public:
         int shrink,
         const cv::Size& sz,
         RealVec& scales,
-        Size2dVec& scaleshw
+        Size2dVec& scaleshw,
+        double minScale = 0.0, // optional: keep scales in [minScale, maxScale] ...
+        double maxScale = std::numeric_limits<double>::max(),
+        int nApprox = 0 // ... extended to the enclosing real scales
     );
     // clang-format on
 
     static int convTri(const MatP& I, MatP& J, double r = 1.0, int s = 1);
 
+    // Cap the vector width (in floats) of the toolbox kernels for all detectors: 4 (SSE/NEON),
+    // 8 (AVX2), 16 (AVX-512) or 0 for the widest one this CPU supports.  All widths compute
+    // identical channels, so this is meant for testing and benchmarks.
+    static void setSimdWidth(int width);
+    static int getSimdWidth();
+
     // clang-format off
     static int gradientMag
     (
@@ -502,6 +649,141 @@ public:
         return m_doParallel;
     }
 
+    // Streaming detection: compute, scan and release the pyramid one group of levels (a real
+    // scale and the scales approximated from it) at a time, bounding peak pyramid memory to
+    // roughly one octave.  Buffers are not retained across frames in this mode.
+    void setDoStreaming(bool flag)
+    {
+        m_doStreaming = flag;
+    }
+
+    bool getDoStreaming() const
+    {
+        return m_doStreaming;
+    }
+
+    // Local nms: run nms on the detections of each pyramid level in parallel before the
+    // final cross scale nms, which then only sees the per level survivors.  This is applied
+    // for the overlap based types ('max' and 'maxg') only.
+    void setDoLocalNms(bool flag)
+    {
+        m_doLocalNms = flag;
+    }
+
+    bool getDoLocalNms() const
+    {
+        return m_doLocalNms;
+    }
+
+    // Expected object size range in image coordinates (0 = unbounded in that dimension):
+    // pyramid levels that can't produce objects in range are not computed or scanned, which
+    // skips the upsampled octave when the smallest object is larger than modelDs.
+    void setMinObjectSize(const cv::Size& size)
+    {
+        m_minObjectSize = size;
+    }
+
+    const cv::Size& getMinObjectSize() const
+    {
+        return m_minObjectSize;
+    }
+
+    void setMaxObjectSize(const cv::Size& size)
+    {
+        m_maxObjectSize = size;
+    }
+
+    const cv::Size& getMaxObjectSize() const
+    {
+        return m_maxObjectSize;
+    }
+
+    // Bounded detection: each scan tile keeps a min heap of its best count raw detections
+    // and drops hits that can't reach the best known count-th score minus margin as they
+    // are found.  A scan then returns its best count detections plus any within margin of
+    // the count-th best, which leaves room for nms to remove duplicates.  0 = unbounded.
+    void setMaxCandidateCount(std::size_t count, double margin = 0.0)
+    {
+        m_maxCandidateCount = count;
+        m_candidateMargin = margin;
+    }
+
+    std::size_t getMaxCandidateCount() const
+    {
+        return m_maxCandidateCount;
+    }
+
+    // Coarse to fine scan: each tile is first scanned at twice the stride with the cascade
+    // threshold lowered by margin, and then at the full stride only around the windows that
+    // pass.  Detections match the dense scan on the coarse lattice, while the remaining
+    // ones are found if a lattice neighbour scores within margin of cascThr (a larger
+    // margin is closer to the dense scan, at the cost of more windows).
+    void setDoCoarseToFine(bool flag, double margin = 1.0)
+    {
+        m_doCoarseToFine = flag;
+        m_coarseToFineMargin = margin;
+    }
+
+    bool getDoCoarseToFine() const
+    {
+        return m_doCoarseToFine;
+    }
+
+    // Number of windows evaluated by the last detection call:
+    std::size_t getEvaluatedWindowCount() const
+    {
+        return m_windowCount;
+    }
+
+    // Time budget for each detection call in seconds (0 = unbounded).  The pyramid is then
+    // computed and scanned one group of levels at a time (see setDoStreaming()) from the
+    // coarsest scale to the finest, and once the budget is spent the remaining levels are
+    // skipped and the detections found so far are returned (see getSkippedScales()).
+    void setTimeBudget(double seconds)
+    {
+        m_timeBudget = seconds;
+    }
+
+    double getTimeBudget() const
+    {
+        return m_timeBudget;
+    }
+
+    // Scales (see Pyramid::scales) that the last detection call skipped, or scanned only in
+    // part, because the time budget ran out (empty if the search was complete):
+    const std::vector<double>& getSkippedScales() const
+    {
+        return m_skippedScales;
+    }
+
+    // Uint8 pyramid: the concatenated channels of each level are stored quantized to 8 bits
+    // (saturate(round(255 * x)), as the GPU pyramid is read back) and scanned with the uint8
+    // thresholds (see Classifier::thrsU8).  Pyramid memory and the bytes touched by the scan
+    // drop 4x, and detections closely track the float pyramid.  Requires pPyramid.concat.
+    void setDoUint8(bool flag)
+    {
+        m_doUint8 = flag;
+    }
+
+    bool getDoUint8() const
+    {
+        return m_doUint8;
+    }
+
+    // Half precision pyramid: as setDoUint8(), but the channels are stored as CV_16F and
+    // widened to float as the scan reads them, with the float thresholds.  Memory and scan
+    // bandwidth drop 2x, without the quantization loss of the uint8 pyramid on low contrast
+    // input.  Requires pPyramid.concat.
+    void setDoHalf(bool flag)
+    {
+        m_doHalf = flag;
+    }
+
+    bool getDoHalf() const
+    {
+        return m_doHalf;
+    }
+
     void setDetectionScorePruneRatio(double ratio) override
     {
         m_detectionScorePruneRatio = ratio;
@@ -566,6 +848,16 @@ public:
         return m_isLuv;
     }
 
+    // Channel order of 8 bit color cv::Mat input: BGR(A) (OpenCV convention) or RGB(A)
+    void setIsBGR(bool flag)
+    {
+        m_isBGR = flag;
+    }
+    bool getIsBGR() const
+    {
+        return m_isBGR;
+    }
+
     void setIsTranspose(bool flag)
     {
         m_isTranspose = flag;
@@ -585,6 +877,18 @@ public:
         m_streamLogger = logger;
     }
 
+    // Pyramid storage used by operator() and computePyramid() (see PyramidWorkspace)
+    const PyramidWorkspace& getPyramidWorkspace() const
+    {
+        return m_workspace;
+    }
+
+    // Per task timing of the scan in the last detection call (see acfDetectPyramid())
+    const std::vector<TaskTiming>& getDetectionTimings() const
+    {
+        return m_detectionTimings;
+    }
+
     void setIsRowMajor(bool flag)
     {
         m_isRowMajor = flag;
@@ -609,14 +913,77 @@ protected:
     ) const;
     // clang-format on
 
+    // Scan all levels of a pyramid: objects[i] holds raw window detections for level i
+    // clang-format off
+    void acfDetectPyramid
+    (
+        const Pyramid& P,
+        int shrink,
+        const cv::Size& modelDsPad,
+        int stride,
+        double cascThr,
+        std::vector<DetectionVec>& objects,
+        const RectVec* windows = nullptr // optional: per level windows to scan (see detectPyramid())
+    );
+    // clang-format on
+
+    void initCoarseToFine(DetectionParams& detector) const; // see setDoCoarseToFine()
+
+    // Reset the per call statistics and start the time budget (see setTimeBudget()):
+    void beginDetection();
+    bool isPastDeadline() const;
+
+    // Pyramid scales that can produce objects in the expected size range (see setMinObjectSize()):
+    void getScaleRange(double& minScale, double& maxScale) const;
+    bool isObjectSizeInRange(const cv::Size& size) const;
+
+    // Scan the populated levels of P and append detections in image coordinates (only the
+    // windows in region if specified):
+    void detectPyramid(const Pyramid& P, DetectionVec& bbs, const SearchRegion* region = nullptr);
+    int finishDetections(DetectionVec& bbs, RectVec& objects, RealVec* scores);
+
+    void computePyramid(const cv::Mat& I, Pyramid& P, const PyramidSink& sink, const PyramidFrame* frame = nullptr);
+    void computePyramid(const MatP& Ip, Pyramid& P, const PyramidSink& sink, const PyramidFrame* frame = nullptr);
+
+    bool ingest(const cv::Mat& I, MatP& Ip, bool doLuv) const;
+    void logPyramid(const Pyramid& P) const;
+
+    static std::shared_ptr<ChannelIndexCache> createChannelIndexCache();
+    std::shared_ptr<ChannelIndexCache> m_channelIndexCache = createChannelIndexCache(); // see createDetector()
+
+    // Per call state (not reentrant, see operator()):
+    PyramidWorkspace m_workspace; // not shared: one detection at a time per Detector
+    std::vector<TaskTiming> m_detectionTimings;
+    std::size_t m_windowCount = 0; // see getEvaluatedWindowCount()
+
     MatLoggerType m_logger;
 
     std::shared_ptr<spdlog::logger> m_streamLogger;
 
     double m_detectScorePruneRatio = 0.0;
     bool m_doParallel = true;
+    bool m_doStreaming = false;
+    bool m_doLocalNms = false;
+
+    cv::Size m_minObjectSize;
+    cv::Size m_maxObjectSize;
+
+    std::size_t m_maxCandidateCount = 0;
+    double m_candidateMargin = 0.0;
+
+    bool m_doCoarseToFine = false;
+    double m_coarseToFineMargin = 1.0;
+
+    double m_timeBudget = 0.0;
+    // Per call state (not reentrant, see operator()):
+    std::chrono::steady_clock::time_point m_deadline = std::chrono::steady_clock::time_point::max();
+    std::vector<double> m_skippedScales;
+
+    bool m_doUint8 = false;
+    bool m_doHalf = false;
 
     bool m_isLuv = false;
+    bool m_isBGR = false;
     bool m_isTranspose = false;
     bool m_isRowMajor = false;
 
@@ -673,6 +1040,7 @@ inline void fuseChannels(Iterator begin, Iterator end, MatP& Ip)
 
 ACF_NAMESPACE_END
 
-void imResample(const MatP& A, MatP& B, const cv::Size& size, double nrm);
+void imResample(const MatP& A, MatP& B, const cv::Size& size, double nrm, const ImResampleCoef* coef = nullptr);
+std::shared_ptr<ImResampleCoef> createImResampleCoef(const cv::Size& sizeA, const cv::Size& sizeB);
 
 #endif /* defined(__acf_ACF_h__) */
@@ -182,6 +182,7 @@ int Detector::deserialize(ParserNodeDetector& detector_)
     }
 
     clf.thrs.convertTo(clf.thrsU8, CV_8UC1, 255.0f); // add uint8_t compatible thresholds
+    clf.compile();
 
     return 0;
 }
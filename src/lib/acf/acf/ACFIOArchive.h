@@ -96,6 +96,7 @@ void Detector::Classifier::serialize(Archive& ar, const std::uint32_t version)
     if (Archive::is_loading::value)
     {
         thrs.convertTo(thrsU8, CV_8UC1, 255.0f); // precompute uint8_t thresholds
+        compile();
     }
 }
 
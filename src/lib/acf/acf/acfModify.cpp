@@ -141,6 +141,7 @@ int Detector::acfModify(const Detector::Modify& pIn)
 
     // calibrate and rescale detector:
     clf.hs += (*params.cascCal);
+    clf.compile();
 
     if (dflt.rescale != 1.0)
     {
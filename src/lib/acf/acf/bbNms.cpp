@@ -14,6 +14,14 @@
 #include <util/ordered.h>
 
 #include <opencv2/core/base.hpp>
+#include <opencv2/core/utility.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <queue>
+#include <unordered_map>
 
 #include <stddef.h>
 
@@ -31,6 +39,11 @@
 // type=='maxg': Similar to 'max', except performs the nms in a greedy
 // fashion. Bbs are processed in order of decreasing score, and, unlike in
 // 'max' nms, once a bb is suppressed it can no longer suppress other bbs.
+//
+// type=='soft' or 'softg': Soft nms. Bbs are processed in order of decreasing
+// score, but rather than suppressing the bbs that overlap a chosen bb their
+// scores decay, linearly ('soft', for overlap above .overlap) or with a
+// gaussian penalty ('softg'). Bbs whose scores decay below thr are removed.
 
 // type='cover': Perform nms by attempting to choose the smallest subset of
 // the bbs such that each remaining bb is within overlap of one of the
@@ -97,125 +110,523 @@ ACF_NAMESPACE_BEGIN
 
 using Detection = Detector::Detection;
 
-static std::vector<Detection> nmsMs(const std::vector<Detection>& bbsIn, double thr, const std::vector<double>& radii)
+// Hash key for a 2D grid cell:
+static std::int64_t gridKey(std::int64_t x, std::int64_t y)
 {
-    return bbsIn;
+    return static_cast<std::int64_t>((static_cast<std::uint64_t>(y) << 32) ^ (static_cast<std::uint64_t>(x) & 0xffffffff));
 }
 
-static std::vector<Detection> nmsCover(const std::vector<Detection>& bbsIn, double overlap, double ovrDnm)
+static std::int64_t gridCell(double x, double size)
 {
-    return bbsIn;
+    return static_cast<std::int64_t>(std::floor(x / size));
 }
 
-// Note: This is very close to the opencv rectangle grouping code (need to compare the two)
-static std::vector<Detection> nmsMax(const std::vector<Detection>& bbsIn, double overlap, bool greedy, double ovrDnm)
+// Mean shift points are box centers with log2 dimensions: (x+w/2, y+h/2, log2(w), log2(h))
+using MsPoint = cv::Vec4d;
+
+// Uniform grid over mean shift points for kernel support queries.  The bandwidth of each
+// point scales with its own width and height, so points are first binned by log2(w) and
+// each bin gets a cell size matching the largest spatial support in that bin.  A query
+// visits the bins within scale support and the 3x3 block of cells around the query in each.
+class MsIndex
 {
-    // for each i suppress all j st j>i and area-overlap>overlap:
+public:
+    MsIndex(const std::vector<MsPoint>& ps, const std::vector<MsPoint>& hs, double support)
+        : m_scaleSupport(0.0)
+    {
+        for (const auto& h : hs)
+        {
+            m_scaleSupport = std::max(m_scaleSupport, h[2] * support);
+        }
 
-    //std::cout << bbsIn.size() << std::endl;
+        for (int i = 0; i < ps.size(); i++)
+        {
+            auto& bin = m_bins[int(std::floor(ps[i][2] / kBinWidth))];
+            bin.cell.width = std::max(bin.cell.width, hs[i][0] * support);
+            bin.cell.height = std::max(bin.cell.height, hs[i][1] * support);
+            bin.points.push_back(i);
+        }
 
-    // i.e., ord = sort(bbsIn(:,5), 'descend');  bbs=bbsIn(ord,:)
-    auto ord = util::ordered(bbsIn, [](const Detection& a, const Detection& b) {
-        return a.score > b.score;
-    });
-    std::vector<Detector::Detection> bbs(bbsIn.size());
+        for (auto& b : m_bins)
+        {
+            auto& bin = b.second;
+            for (const auto& i : bin.points)
+            {
+                bin.cells[key(bin, ps[i])].push_back(i);
+            }
+            bin.points.clear();
+        }
+    }
 
-    // Convert rois to area and tl + br corner (preserve matlab readability)
-    size_t n = bbs.size();
-    struct Roi
+    // Call visitor(j) for every point j whose kernel may have support at p:
+    template <typename Visitor>
+    void visit(const MsPoint& p, Visitor&& visitor) const
     {
-        int as, xs, xe, ys, ye, kp;
+        const int b0 = int(std::floor((p[2] - m_scaleSupport) / kBinWidth));
+        const int b1 = int(std::floor((p[2] + m_scaleSupport) / kBinWidth));
+        for (auto b = m_bins.lower_bound(b0); (b != m_bins.end()) && (b->first <= b1); b++)
+        {
+            const auto& bin = b->second;
+            const auto cx = gridCell(p[0], bin.cell.width), cy = gridCell(p[1], bin.cell.height);
+            for (auto y = cy - 1; y <= cy + 1; y++)
+            {
+                for (auto x = cx - 1; x <= cx + 1; x++)
+                {
+                    const auto iter = bin.cells.find(gridKey(x, y));
+                    if (iter != bin.cells.end())
+                    {
+                        for (const auto& j : iter->second)
+                        {
+                            visitor(j);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+protected:
+    static constexpr double kBinWidth = 0.5; // octaves
+
+    struct Bin
+    {
+        cv::Size2d cell;
+        std::vector<int> points;
+        std::unordered_map<std::int64_t, std::vector<int>> cells;
     };
-    std::vector<Roi> coords(n);
-    for (int i = 0; i < n; i++)
+
+    static std::int64_t key(const Bin& bin, const MsPoint& p)
     {
-        bbs[i] = bbsIn[ord[i]];
+        return gridKey(gridCell(p[0], bin.cell.width), gridCell(p[1], bin.cell.height));
+    }
+
+    double m_scaleSupport;
+    std::map<int, Bin> m_bins;
+};
 
-        //std::cout << bbs[i].score << std::endl;
+constexpr double MsIndex::kBinWidth;
+
+// Mean shift with a variable bandwidth kernel (see nmsMs1() in the toolbox bbNms.m).  Each
+// point is shifted to the score weighted mean of its neighbors under a gaussian kernel
+// with per neighbor bandwidth [w*radii(1) h*radii(2) radii(3) radii(4)] until it moves less
+// than stopThr per dimension, and the modes are then merged greedily (nonMaxSuprList).
+static std::vector<Detection> nmsMs(const std::vector<Detection>& bbsIn, double thr, const std::vector<double>& radii)
+{
+    static const double kStopThr = 1e-2;
+    static const double kSupport = 16.0; // truncate the kernel at exp(-16) ~ 1e-7
+    static const int kMaxIterations = 100;
 
-        // Convenient storage of tl, br coordinates (per matlab code)
-        coords[i].kp = 1;
-        coords[i].as = bbs[i].roi.size().area();
-        coords[i].xs = bbs[i].roi.x;
-        coords[i].ys = bbs[i].roi.y;
-        coords[i].xe = bbs[i].roi.br().x;
-        coords[i].ye = bbs[i].roi.br().y;
+    CV_Assert(radii.size() == 4);
+
+    // remove bbs below threshold; ws=weights-thr
+    std::vector<MsPoint> ps, hInv, hs;
+    std::vector<double> ws;
+    for (const auto& bb : bbsIn)
+    {
+        if ((bb.score > thr) && (bb.roi.area() > 0))
+        {
+            const double lw = std::log2(bb.roi.width), lh = std::log2(bb.roi.height);
+            ps.emplace_back(bb.roi.x + bb.roi.width * 0.5, bb.roi.y + bb.roi.height * 0.5, lw, lh);
+            hs.emplace_back(bb.roi.width * radii[0], bb.roi.height * radii[1], radii[2], radii[3]);
+            hInv.emplace_back(1.0 / hs.back()[0], 1.0 / hs.back()[1], 1.0 / hs.back()[2], 1.0 / hs.back()[3]);
+            ws.push_back(bb.score - thr);
+        }
     }
 
-    for (int i = 0; i < n; i++)
+    const int n = static_cast<int>(ps.size());
+    if (n == 0)
     {
-        if (greedy && !coords[i].kp)
+        return {};
+    }
+
+    // find modes starting from each elt:
+    const MsIndex index(ps, hs, std::sqrt(kSupport));
+    std::vector<MsPoint> ps1(n);
+    std::vector<double> ws1(n);
+    cv::parallel_for_({ 0, n }, [&](const cv::Range& r) {
+        for (int i = r.start; i < r.end; i++)
         {
-            continue;
+            MsPoint p = ps[i];
+            double w = ws[i];
+            for (int k = 0; k < kMaxIterations; k++)
+            {
+                // wMask=ws.*exp(-d); wMask=wMask/sum(wMask); p1=wMask'*ps; w=sum(ws.*wMask)
+                MsPoint p1;
+                double sum = 0.0, sumW = 0.0;
+                index.visit(p, [&](int j) {
+                    const MsPoint d = (ps[j] - p).mul(hInv[j]);
+                    const double dd = d.dot(d);
+                    if (dd < kSupport)
+                    {
+                        const double wMask = ws[j] * std::exp(-dd);
+                        p1 += ps[j] * wMask;
+                        sum += wMask;
+                        sumW += ws[j] * wMask;
+                    }
+                });
+                if (sum <= 0.0)
+                {
+                    break;
+                }
+
+                p1 *= (1.0 / sum);
+                w = sumW / sum;
+
+                const double diff = cv::norm(p1 - p, cv::NORM_L1) / 4.0;
+                p = p1;
+                if (diff < kStopThr)
+                {
+                    break;
+                }
+            }
+            ps1[i] = p;
+            ws1[i] = w;
         }
+    });
 
-        for (int j = i + 1; j < n; j++)
+    // merge modes that are within stopThr*100 of a stronger mode:
+    const double mergeRadius = kStopThr * 100.0;
+    const auto ord = util::ordered(ws1, [](double a, double b) { return a > b; });
+    std::unordered_map<std::int64_t, std::vector<int>> modes;
+    std::vector<Detection> bbs;
+    for (const auto& i : ord)
+    {
+        const auto& p = ps1[i];
+        const auto cx = gridCell(p[0], mergeRadius), cy = gridCell(p[1], mergeRadius);
+
+        bool keep = true;
+        for (auto y = cy - 1; keep && (y <= cy + 1); y++)
         {
-            if (coords[j].kp == 0)
+            for (auto x = cx - 1; keep && (x <= cx + 1); x++)
             {
-                continue;
+                const auto iter = modes.find(gridKey(x, y));
+                for (int k = 0; keep && (iter != modes.end()) && (k < iter->second.size()); k++)
+                {
+                    const MsPoint d = p - ps1[iter->second[k]];
+                    keep = (d.dot(d) >= (mergeRadius * mergeRadius));
+                }
             }
+        }
+
+        if (keep)
+        {
+            modes[gridKey(cx, cy)].push_back(i);
 
-            int iw = std::min(coords[i].xe, coords[j].xe) - std::max(coords[i].xs, coords[j].xs);
-            if (iw <= 0)
+            // convert back to bbs format (sorted by weight)
+            const double w = std::pow(2.0, p[2]), h = std::pow(2.0, p[3]);
+            const cv::Rect roi(cvRound(p[0] - w * 0.5), cvRound(p[1] - h * 0.5), cvRound(w), cvRound(h));
+            bbs.emplace_back(roi, ws1[i] + thr);
+        }
+    }
+
+    return bbs;
+}
+
+// Build the overlap graph (edges between bbs with area-overlap>overlap, ovrDnm: 1=union,
+// 0=min) with a sweep over x-intervals sorted by their left edge: each bb is only compared
+// with the active bbs whose x-intervals are still open, rather than with all other bbs.
+// Active coordinates are kept as compacted SoA arrays so the overlap loop vectorizes.
+static std::vector<std::vector<int>> overlapGraph(const std::vector<Detection>& bbs, double overlap, double ovrDnm)
+{
+    const auto ord = util::ordered(bbs, [](const Detection& a, const Detection& b) {
+        return a.roi.x < b.roi.x;
+    });
+
+    // Convenient storage of tl, br coordinates and area (per matlab code)
+    const int n = static_cast<int>(bbs.size());
+    std::vector<int> xs(n), xe(n), ys(n), ye(n), id(n);
+    std::vector<double> as(n), os(n);
+
+    std::vector<std::vector<int>> edges(n);
+    int m = 0; // active bbs
+    for (const auto& i : ord)
+    {
+        const auto& roi = bbs[i].roi;
+        const int xs1 = roi.x, xe1 = roi.br().x, ys1 = roi.y, ye1 = roi.br().y;
+        const double as1 = roi.area();
+
+        // drop the bbs that end before this one starts:
+        int k1 = 0;
+        for (int k = 0; k < m; k++)
+        {
+            if (xe[k] > xs1)
             {
-                continue;
+                xs[k1] = xs[k], xe[k1] = xe[k], ys[k1] = ys[k], ye[k1] = ye[k], as[k1] = as[k], id[k1] = id[k];
+                k1++;
             }
+        }
+        m = k1;
+
+        for (int k = 0; k < m; k++)
+        {
+            const int iw = std::max(std::min(xe1, xe[k]) - std::max(xs1, xs[k]), 0);
+            const int ih = std::max(std::min(ye1, ye[k]) - std::max(ys1, ys[k]), 0);
+            const double o = (iw * ih), u = (ovrDnm) ? (as1 + as[k] - o) : std::min(as1, as[k]);
+            os[k] = o / u;
+        }
 
-            int ih = std::min(coords[i].ye, coords[j].ye) - std::max(coords[i].ys, coords[j].ys);
-            if (ih <= 0)
+        for (int k = 0; k < m; k++)
+        {
+            if (os[k] > overlap)
             {
-                continue;
+                edges[i].push_back(id[k]);
+                edges[id[k]].push_back(int(i));
             }
+        }
 
-            double o = (iw * ih), u = (ovrDnm) ? (coords[i].as + coords[j].as - o) : std::min(coords[i].as, coords[j].as);
-            o /= u;
+        xs[m] = xs1, xe[m] = xe1, ys[m] = ys1, ye[m] = ye1, as[m] = as1, id[m] = int(i);
+        m++;
+    }
+
+    return edges;
+}
+
+// Greedy weighted set cover: repeatedly pick the uncovered bb covering the largest total
+// weight of still uncovered bbs (itself and the bbs it overlaps) until every bb is covered.
+// Covered bbs have no gain, so they are never picked (N(N0,:)=0 in the toolbox).  Gains
+// only decrease as bbs are covered, so picks come from a lazy priority queue: a popped bb
+// whose gain is stale is re-queued with its current gain instead of rescanning all bbs.
+// Weights are scores offset to be positive so the gains stay monotone for any cascThr, and
+// the score of each chosen bb is set to the summed scores of the bbs it covers.
+static std::vector<Detection> nmsCover(const std::vector<Detection>& bbsIn, double overlap, double ovrDnm)
+{
+    const int n = static_cast<int>(bbsIn.size());
+    const auto edges = overlapGraph(bbsIn, overlap, ovrDnm);
+
+    double minScore = std::numeric_limits<double>::max();
+    for (const auto& bb : bbsIn)
+    {
+        minScore = std::min(minScore, bb.score);
+    }
+
+    std::vector<double> ws(n);
+    for (int i = 0; i < n; i++)
+    {
+        ws[i] = bbsIn[i].score - minScore + std::numeric_limits<float>::epsilon();
+    }
 
-            if (o > overlap)
+    std::vector<bool> covered(n, false);
+    auto gain = [&](int i) {
+        if (covered[i])
+        {
+            return 0.0;
+        }
+        double g = ws[i];
+        for (const auto& j : edges[i])
+        {
+            g += covered[j] ? 0.0 : ws[j];
+        }
+        return g;
+    };
+
+    using Candidate = std::pair<double, int>; // { gain, index }
+    std::priority_queue<Candidate> queue;
+    for (int i = 0; i < n; i++)
+    {
+        queue.emplace(gain(i), i);
+    }
+
+    std::vector<Detection> bbs;
+    while (!queue.empty())
+    {
+        const auto top = queue.top();
+        queue.pop();
+
+        const double g = gain(top.second);
+        if (g <= 0.0)
+        {
+            continue; // this bb is already covered
+        }
+        if (!queue.empty() && (g < queue.top().first))
+        {
+            queue.emplace(g, top.second); // stale
+            continue;
+        }
+
+        const int i = top.second;
+        double score = bbsIn[i].score;
+        covered[i] = true;
+        for (const auto& j : edges[i])
+        {
+            if (!covered[j])
             {
-                coords[j].kp = 0;
+                score += bbsIn[j].score;
+                covered[j] = true;
+            }
+        }
+        bbs.emplace_back(bbsIn[i].roi, score);
+    }
+
+    return bbs;
+}
+
+// Note: This is very close to the opencv rectangle grouping code (need to compare the two)
+static std::vector<Detection> nmsMax(const std::vector<Detection>& bbsIn, double overlap, bool greedy, double ovrDnm)
+{
+    // i.e., ord = sort(bbsIn(:,5), 'descend');  bbs=bbsIn(ord,:)
+    auto ord = util::ordered(bbsIn, [](const Detection& a, const Detection& b) {
+        return a.score > b.score;
+    });
+    std::vector<Detector::Detection> bbs(bbsIn.size());
+    for (int i = 0; i < bbs.size(); i++)
+    {
+        bbs[i] = bbsIn[ord[i]];
+    }
+
+    // for each i suppress all j st j>i and area-overlap>overlap:
+    const auto edges = overlapGraph(bbs, overlap, ovrDnm);
+    std::vector<int> kp(bbs.size(), 1);
+    for (int i = 0; i < bbs.size(); i++)
+    {
+        if (greedy && !kp[i])
+        {
+            continue;
+        }
 
-                //std::cout << j << " " << o << std::endl;
+        for (const auto& j : edges[i])
+        {
+            if (j > i)
+            {
+                kp[j] = 0;
             }
         }
     }
 
-    // Delete the boxes with kp[i] < 0
-    auto pkp = coords.begin();
+    // Delete the boxes with kp[i] == 0
+    auto pkp = kp.begin();
     auto pbb = bbs.begin();
-    while (pkp != coords.end())
+    while (pkp != kp.end())
     {
-        pbb = (pkp++)->kp ? (pbb + 1) : bbs.erase(pbb);
+        pbb = *(pkp++) ? (pbb + 1) : bbs.erase(pbb);
     }
 
     return bbs;
 }
 
-static void nms1(const std::vector<Detection>& bbsIn, std::vector<Detection>& bbs, const Detector::Options::Nms& pNms, double ovrDnm)
+// Soft nms: instead of suppressing the bbs that overlap a chosen bb their scores decay
+// toward thr, either linearly for area-overlap>overlap (by 1-o) or with a gaussian penalty
+// (by exp(-o^2/sigma)): score = thr + (score - thr) * decay.  Decaying the margin above thr
+// rather than the score itself lowers negative scores too (ACF scores are often negative).
+// Bbs are chosen in order of decreasing (decayed) score and bbs whose margin decays below
+// kMinMargin are dropped, so the loop terminates as soon as no remaining bb has a margin.
+// This requires a finite thr (see bbNms()).  The remaining bbs are kept as compacted SoA
+// arrays so the decay loop vectorizes.
+static std::vector<Detection> nmsSoft(const std::vector<Detection>& bbsIn, double thr, double overlap, bool gaussian, double ovrDnm)
 {
-    // TODO: The original code splits large vectors in two, runs nms on each half, then runs nms again on result
-    // We don't bother with that here:
+    static const double kSigma = 0.5;      // gaussian penalty (Bodla et al.)
+    static const double kMinMargin = 1e-3; // pruning threshold (Bodla et al., for thr = 0)
+
+    CV_Assert(thr > std::numeric_limits<double>::lowest());
+
+    const int n = static_cast<int>(bbsIn.size());
+    std::vector<int> xs(n), xe(n), ys(n), ye(n), id(n);
+    std::vector<double> as(n), ss(n);
+    for (int i = 0; i < n; i++)
+    {
+        const auto& roi = bbsIn[i].roi;
+        xs[i] = roi.x, xe[i] = roi.br().x, ys[i] = roi.y, ye[i] = roi.br().y, as[i] = roi.area(), ss[i] = bbsIn[i].score, id[i] = i;
+    }
+
+    std::vector<Detection> bbs;
+    int m = n;
+    while (m > 0)
+    {
+        const int k = static_cast<int>(std::distance(ss.begin(), std::max_element(ss.begin(), ss.begin() + m)));
+        if ((ss[k] - thr) < kMinMargin)
+        {
+            break;
+        }
+        bbs.emplace_back(bbsIn[id[k]].roi, ss[k]);
+
+        const int xs1 = xs[k], xe1 = xe[k], ys1 = ys[k], ye1 = ye[k];
+        const double as1 = as[k];
+
+        // remove the chosen bb (move the last one into its slot):
+        m--;
+        xs[k] = xs[m], xe[k] = xe[m], ys[k] = ys[m], ye[k] = ye[m], as[k] = as[m], ss[k] = ss[m], id[k] = id[m];
+
+        // decay the remaining scores:
+        for (int j = 0; j < m; j++)
+        {
+            const int iw = std::max(std::min(xe1, xe[j]) - std::max(xs1, xs[j]), 0);
+            const int ih = std::max(std::min(ye1, ye[j]) - std::max(ys1, ys[j]), 0);
+            const double o = (iw * ih), u = (ovrDnm) ? (as1 + as[j] - o) : std::min(as1, as[j]);
+            const double r = o / u;
+            ss[j] = thr + (ss[j] - thr) * (gaussian ? std::exp(-(r * r) / kSigma) : ((r > overlap) ? (1.0 - r) : 1.0));
+        }
 
+        // drop the bbs that decayed to thr:
+        int j1 = 0;
+        for (int j = 0; j < m; j++)
+        {
+            if ((ss[j] - thr) >= kMinMargin)
+            {
+                xs[j1] = xs[j], xe[j1] = xe[j], ys[j1] = ys[j], ye[j1] = ye[j], as[j1] = as[j], ss[j1] = ss[j], id[j1] = id[j];
+                j1++;
+            }
+        }
+        m = j1;
+    }
+
+    return bbs;
+}
+
+static void nms1(const std::vector<Detection>& bbsIn, std::vector<Detection>& bbs, const Detector::Options::Nms& pNms, double ovrDnm, bool isy = false)
+{
+    // if big split in two (by x or y center, alternating), recurse, merge, then run on merged:
+    std::vector<Detection> bbsMerged;
+    const bool split = (bbsIn.size() > (*pNms.maxn));
+    if (split)
+    {
+        auto ord = util::ordered(bbsIn, [&](const Detection& a, const Detection& b) {
+            return isy ? ((a.roi.y * 2 + a.roi.height) < (b.roi.y * 2 + b.roi.height)) : ((a.roi.x * 2 + a.roi.width) < (b.roi.x * 2 + b.roi.width));
+        });
+
+        const auto n2 = bbsIn.size() / 2;
+        std::vector<Detection> bbs0(n2), bbs1(bbsIn.size() - n2);
+        for (int i = 0; i < bbsIn.size(); i++)
+        {
+            ((i < n2) ? bbs0[i] : bbs1[i - n2]) = bbsIn[ord[i]];
+        }
+
+        nms1(bbs0, bbs0, pNms, ovrDnm, !isy);
+        nms1(bbs1, bbs1, pNms, ovrDnm, !isy);
+        bbsMerged.swap(bbs0);
+        bbsMerged.insert(bbsMerged.end(), bbs1.begin(), bbs1.end());
+    }
+    const auto& bbs1 = split ? bbsMerged : bbsIn;
+
+    // run actual nms on given bbs
     switch (string_hash::hash((*pNms.type)))
     {
         case "max"_hash:
         {
-            bbs = nmsMax(bbsIn, pNms.overlap, false, ovrDnm);
+            bbs = nmsMax(bbs1, pNms.overlap, false, ovrDnm);
         }
         break;
         case "maxg"_hash:
         {
-            bbs = nmsMax(bbsIn, pNms.overlap, true, ovrDnm);
+            bbs = nmsMax(bbs1, pNms.overlap, true, ovrDnm);
         }
         break;
         case "ms"_hash:
         {
-            bbs = nmsMs(bbsIn, pNms.thr, pNms.radii);
+            bbs = nmsMs(bbs1, pNms.thr, pNms.radii);
         }
         break;
         case "cover"_hash:
         {
-            bbs = nmsCover(bbsIn, pNms.overlap, ovrDnm);
+            bbs = nmsCover(bbs1, pNms.overlap, ovrDnm);
+        }
+        break;
+        case "soft"_hash:
+        {
+            bbs = nmsSoft(bbs1, pNms.thr, pNms.overlap, false, ovrDnm);
+        }
+        break;
+        case "softg"_hash:
+        {
+            bbs = nmsSoft(bbs1, pNms.thr, pNms.overlap, true, ovrDnm);
         }
         break;
         default:
@@ -241,6 +652,13 @@ int Detector::bbNms(const std::vector<Detection>& bbsIn, const Options::Nms& pNm
 
     double thr = (pNms.thr.has) ? (*pNms.thr) : ((pNms.type.has && !pNms.type->compare("ms")) ? 0.0 : -ACF_INFINITY);
 
+    // Soft nms decays scores toward thr, which defaults to the cascade threshold:
+    const bool isSoft = !pNms.type->compare("soft") || !pNms.type->compare("softg");
+    if (isSoft && !pNms.thr.has && opts.cascThr.has)
+    {
+        thr = *opts.cascThr;
+    }
+
     int ovrDnm = 0; // std::cout << pNms.ovrDnm << " in " << pNmsI.ovrDnm << std::endl;
     switch (string_hash::hash((*pNms.ovrDnm)))
     {
@@ -131,17 +131,24 @@
 #include <acf/ACF.h>
 #include <acf/MatP.h>
 #include <acf/acf_common.h>
+#include <acf/toolbox/wrappers.hpp>
 
 #include <opencv2/core/base.hpp>
 #include <opencv2/core/mat.hpp>
 #include <opencv2/core/mat.inl.hpp>
 #include <opencv2/core/types.hpp>
 
+#include <cmath>
 #include <iosfwd>
 
+// Declarations:
+void chnsFused(float* I, float* C, float* M, float* H, int h, int w, int d, int shrink, double smooth, int colorChn, int normRad, float normConst, bool full, int nOrients, int softBin, int band);
+
 ACF_NAMESPACE_BEGIN
 
-static int addChn(Detector::Channels& chns, const MatP& data, const std::string& name, const std::string& padWith, int h, int w);
+static int addChn(Detector::Channels& chns, std::vector<MatP>& recycled, const MatP& data, const std::string& name, const std::string& padWith, int h, int w);
+static bool chnsComputeFused(const MatP& I, const Detector::Options::Pyramid::Chns& pChns, Detector::Channels& chns, std::vector<MatP>& recycled, int h, int w);
+static MatP reuse(std::vector<MatP>& recycled, int index, const cv::Size& size, int depth, int channels);
 
 int Detector::chnsCompute
 (
@@ -196,8 +203,16 @@ int Detector::chnsCompute
         return 0;
     }
 
-    // Create output struct:
+    // Toolbox temporaries are drawn from the scratch arena of this thread and released in
+    // bulk at the end of the call (see alScratch()):
+    ScratchScope scratch;
+
+    // Create output struct, with the planes of a previous call as output buffers (see reuse()):
     Channels::Info info;
+    std::vector<MatP> recycled;
+    recycled.swap(chns.data);
+    chns.nTypes = 0;
+    chns.info.clear();
 
     // Crop I so divisible by shrink and get target dimensions:
     MatP I, MO;
@@ -233,10 +248,20 @@ int Detector::chnsCompute
         auto p = pChns.pColor.get();
         std::string nm = "color channels";
         rgbConvert(I, I, p.colorSpace, true, pChnsIn.isLuv);
-        
+
+        if (pChnsIn.doFused && !pLogger && !MO.channels() && chnsComputeFused(I, pChns, chns, recycled, h, w))
+        {
+            chns.pChns = pChns;
+            return 0;
+        }
+
         if (I.channels())
         {
-            convTri(I, I, p.smooth, 1);
+            // Smooth into a new buffer: I may share data with the caller's image, which
+            // chnsPyramid() reuses as the source for other (concurrent) scales.
+            MatP Is;
+            convTri(I, Is, p.smooth, 1);
+            I = Is;
 
             if (pLogger)
             {
@@ -252,7 +277,7 @@ int Detector::chnsCompute
 
         if (p.enabled.get())
         {
-            addChn(chns, I, nm, "replicate", h, w);
+            addChn(chns, recycled, I, nm, "replicate", h, w);
         }
     }
 
@@ -303,7 +328,7 @@ int Detector::chnsCompute
         if (p.enabled)
         {
             MatP Mp(M);
-            addChn(chns, Mp, nm, {}, h, w);
+            addChn(chns, recycled, Mp, nm, {}, h, w);
         }
     }
 
@@ -329,7 +354,7 @@ int Detector::chnsCompute
                 }
             }
 
-            addChn(chns, Hp, nm, {}, h, w);
+            addChn(chns, recycled, Hp, nm, {}, h, w);
         }
     }
     chns.pChns = pChns;
@@ -337,7 +362,78 @@ int Detector::chnsCompute
     return 0;
 }
 
-static int addChn(Detector::Channels& chns, const MatP& dataIn, const std::string& name, const std::string& padWith, int h, int w)
+// Compute the color, gradient magnitude and gradient histogram channels of the color
+// converted image I in one banded pass (see chnsFused()), as the separate stages in
+// chnsCompute() would.  Returns false, leaving chns untouched, for parameters outside of
+// what the banded pass reproduces exactly.
+static bool chnsComputeFused(const MatP& I, const Detector::Options::Pyramid::Chns& pChns, Detector::Channels& chns, std::vector<MatP>& recycled, int h, int w)
+{
+    const auto pColor = pChns.pColor.get();
+    const auto pGradMag = pChns.pGradMag.get();
+    const auto pGradHist = pChns.pGradHist.get();
+    const int shrink = pChns.shrink.get();
+    const int binSize = (pGradHist.binSize.has) ? pGradHist.binSize.get() : shrink;
+    if (!pColor.enabled.get() || !pGradMag.enabled.get() || !pGradHist.enabled.get() || binSize != shrink)
+    {
+        return false;
+    }
+
+    // The band resampling only matches the full image one for the integer box filters:
+    if (shrink < 1 || shrink > 4 || I.empty() || I.depth() != CV_32F || pGradMag.colorChn.get() >= I.channels())
+    {
+        return false;
+    }
+
+    // Planes must be stacked in one buffer (not a cropped view) as the toolbox expects:
+    const int rows = I.rows(), cols = I.cols(), d = I.channels();
+    const auto* base = I.ptr<float>();
+    for (int z = 0; z < d; z++)
+    {
+        if (!base || !I[z].isContinuous() || I[z].ptr<float>() != base + z * rows * cols)
+        {
+            return false;
+        }
+    }
+
+    // Both filters must take the toolbox path of convTri() (see its nomex condition):
+    const int m = std::min(rows, cols);
+    for (double r : { pColor.smooth.get(), double(pGradMag.normRad.get()) })
+    {
+        if ((r != 0.0) && ((m < 4) || ((2 * r + 1) >= m) || (r < 0.0) || (std::round(float(r)) >= (m / 2))))
+        {
+            return false;
+        }
+    }
+
+    MatP C = reuse(recycled, 0, { w, h }, CV_32F, d);
+    MatP M = reuse(recycled, 1, { w, h }, CV_32F, 1);
+    MatP H = reuse(recycled, 2, { w, h }, CV_32F, pGradHist.nOrients.get());
+    const int full = (pGradMag.full.has) ? pGradMag.full.get() : 0;
+    chnsFused(const_cast<float*>(base), C.ptr<float>(), M.ptr<float>(), H.ptr<float>(), cols, rows, d, shrink, pColor.smooth.get(), pGradMag.colorChn.get(), pGradMag.normRad.get(), float(pGradMag.normConst.get()), full, pGradHist.nOrients.get(), pGradHist.softBin.get(), 0);
+
+    addChn(chns, recycled, C, "color channels", "replicate", h, w);
+    addChn(chns, recycled, M, "gradient magnitude", {}, h, w);
+    addChn(chns, recycled, H, "gradient histogram", {}, h, w);
+    return true;
+}
+
+// Plane index of a previous call if it has the requested geometry and nothing outside of
+// recycled references it (the base plus one ROI header per plane), else a new plane:
+static MatP reuse(std::vector<MatP>& recycled, int index, const cv::Size& size, int depth, int channels)
+{
+    if (index < static_cast<int>(recycled.size()))
+    {
+        const MatP& plane = recycled[index];
+        const cv::Mat& base = plane.base();
+        if (!plane.empty() && (plane.size() == size) && (plane.depth() == depth) && (plane.channels() == channels) && base.u && (base.u->refcount == (1 + plane.channels())))
+        {
+            return plane;
+        }
+    }
+    return MatP(size, depth, channels);
+}
+
+static int addChn(Detector::Channels& chns, std::vector<MatP>& recycled, const MatP& dataIn, const std::string& name, const std::string& padWith, int h, int w)
 {
     //[h1,w1,~]=size(data);
     //if(h1~=h || w1~=w), data=imResampleMex(data,h,w,1);
@@ -346,7 +442,7 @@ static int addChn(Detector::Channels& chns, const MatP& dataIn, const std::strin
     MatP data;
     if (dataIn.size() != cv::Size(w, h))
     {
-        data.create(cv::Size(w, h), dataIn.depth(), dataIn.channels());
+        data = reuse(recycled, chns.nTypes, cv::Size(w, h), dataIn.depth(), dataIn.channels());
         imResample(dataIn, data, cv::Size(w, h), 1.0);
     }
     else
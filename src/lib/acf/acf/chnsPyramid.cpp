@@ -125,14 +125,18 @@
 #include <acf/ACF.h>
 #include <acf/MatP.h>
 #include <acf/acf_common.h>
-#include <acf/random.h>
+#include <acf/tasks.h>
 #include <util/acf_math.h>
 
 #include <opencv2/core/base.hpp>
 #include <opencv2/core/types.hpp>
 
+#include <algorithm>
 #include <cmath>
+#include <functional>
 #include <iosfwd>
+#include <iterator>
+#include <numeric>
 #include <utility>
 
 ACF_NAMESPACE_BEGIN
@@ -157,13 +161,143 @@ cv::Size round(const cv::Size_<T>& size)
  *  (const Options::Pyramid*) p == nullptr
  */
 
+// A workspace buffer is reused if it has the requested geometry and nothing outside the
+// workspace holds a reference to it (i.e., the base plus one ROI header per plane):
+static bool isUnique(const MatP& buffer)
+{
+    const cv::Mat& base = buffer.base();
+    return base.u && (base.u->refcount == (1 + buffer.channels()));
+}
+
+static void reserve(std::size_t& allocations, std::size_t& bytes, MatP& buffer, const cv::Size& size, int depth, int channels)
+{
+    if (!buffer.empty() && (buffer.size() == size) && (buffer.depth() == depth) && (buffer.channels() == channels) && isUnique(buffer))
+    {
+        return;
+    }
+
+    buffer = MatP();
+    buffer.create(size, depth, channels);
+    allocations++;
+    bytes += buffer.base().total() * buffer.base().elemSize();
+}
+
+static void reserve(Detector::PyramidWorkspace& ws, MatP& buffer, const cv::Size& size, int depth, int channels)
+{
+    reserve(ws.allocations, ws.bytes, buffer, size, depth, channels);
+}
+
+// Layout the pyramid for a new input size or new parameters (see PyramidPlan):
+static void createPlan(Detector::PyramidPlan& plan, const cv::Size& sz, int nPerOct, int nOctUp, int nApprox, const cv::Size& minDs, int shrink, const cv::Size& pad, double minScale, double maxScale, const cv::Size& frame)
+{
+    plan = {};
+    plan.size = sz;
+    plan.nPerOct = nPerOct;
+    plan.nOctUp = nOctUp;
+    plan.nApprox = nApprox;
+    plan.minDs = minDs;
+    plan.shrink = shrink;
+    plan.pad = pad;
+    plan.minScale = minScale;
+    plan.maxScale = maxScale;
+    plan.frame = frame;
+
+    Detector::getScales(nPerOct, nOctUp, minDs, shrink, frame.area() ? frame : sz, plan.scales, plan.scaleshw, minScale, maxScale, nApprox);
+    if (frame.area())
+    {
+        // Full frame scales, tile geometry (see getScales()):
+        for (int i = 0; i < plan.scales.size(); i++)
+        {
+            const double s = plan.scales[i];
+            const double x = std::round(double(sz.width) * s / shrink) * shrink / sz.width;
+            const double y = std::round(double(sz.height) * s / shrink) * shrink / sz.height;
+            plan.scaleshw[i] = { x, y };
+        }
+
+        // Without a scale range (see chnsPyramid()) the smallest levels can vanish in the tile:
+        while (plan.scales.size() && !round(cv::Size2d(sz) * plan.scales.back() / double(shrink)).area())
+        {
+            plan.scales.pop_back();
+            plan.scaleshw.pop_back();
+        }
+    }
+
+    auto nScales = static_cast<int>(plan.scales.size());
+    auto &isR = plan.isR, &isA = plan.isA, &isN = plan.isN;
+    std::vector<int>* isRA[2] = { &isR, &isA };
+    isN.assign(nScales, 0);
+    for (int i = 0; i < nScales; i++)
+    {
+        isRA[(i % (nApprox + 1)) > 0]->push_back(i + 1);
+    }
+
+    std::vector<int> isH((isR.size() + 1), 0);
+    isH.back() = nScales;
+    for (int i = 0; i < std::max(int(isR.size()) - 1, 0); i++)
+    {
+        isH[i + 1] = (isR[i] + isR[i + 1]) / 2;
+    }
+
+    for (int i = 0; i < isR.size(); i++)
+    {
+        for (int j = isH[i]; j < isH[i + 1]; j++)
+        {
+            isN[j] = isR[i];
+        }
+    }
+
+    // Real scales are resampled from the input image, or from the half scale image once it
+    // has been computed (mirrors the real scale loop in chnsPyramid()):
+    int source = -1;
+    for (int k = 0; k < isR.size(); k++)
+    {
+        const double s = plan.scales[isR[k] - 1];
+        const cv::Size sz1 = round((cv::Size2d(sz) * s) / double(shrink)) * shrink;
+        const cv::Size src = (source < 0) ? sz : plan.imageSizes[source];
+        plan.imageSource.push_back(source);
+        plan.imageSizes.push_back(sz1);
+        plan.imageCoef.push_back((sz == sz1) ? nullptr : createImResampleCoef(src, sz1));
+        if ((s == 0.5) && ((nApprox > 0) || (nPerOct == 1)))
+        {
+            source = k;
+        }
+    }
+
+    plan.border = { pad.width / shrink, pad.height / shrink };
+    plan.chnsSizes.resize(nScales);
+    plan.paddedSizes.resize(nScales);
+    plan.chnsCoef.resize(nScales);
+    for (int i = 0; i < nScales; i++)
+    {
+        plan.chnsSizes[i] = round(cv::Size2d(sz) * plan.scales[i] / double(shrink));
+        plan.paddedSizes[i] = plan.chnsSizes[i] + cv::Size(plan.border.x * 2, plan.border.y * 2);
+    }
+
+    for (const auto& i : isA)
+    {
+        plan.chnsCoef[i - 1] = createImResampleCoef(plan.chnsSizes[isN[i - 1] - 1], plan.chnsSizes[i - 1]);
+    }
+
+    plan.groups.resize(isR.size());
+    for (int k = 0; k < isR.size(); k++)
+    {
+        for (int j = isH[k]; j < isH[k + 1]; j++)
+        {
+            plan.groups[k].push_back(j);
+        }
+    }
+}
+
 int Detector::chnsPyramid
 (
     const MatP& Iin,
     const Options::Pyramid* pIn,
     Pyramid& pyramid,
     bool isInit,
-    const MatLoggerType& pLogger
+    const MatLoggerType& pLogger,
+    PyramidWorkspace* workspace,
+    const PyramidSink& sink,
+    const PyramidFrame* frame
 )
 {
     // % get default parameters pPyramid
@@ -174,6 +308,9 @@ int Detector::chnsPyramid
         p = *pIn;
     }
 
+    // Input is already luv: either globally (setIsLuv()) or for this call (see computePyramid())
+    const bool isLuv = m_isLuv || p.pChns->isLuv;
+
     if (!p.complete.has || (p.complete != 1) || Iin.empty())
     {
         // 'pChns',{},,'nOctUp',0,'nApprox',-1,'lambdas',[],'pad',[0 0], ...
@@ -225,7 +362,7 @@ int Detector::chnsPyramid
     auto concat = p.concat.get();
     auto shrink = pChns.shrink.get();
 
-    pChns.isLuv = m_isLuv; // propagate LUV special case through to static function
+    pChns.isLuv = isLuv; // propagate LUV special case through to static function
 
     // Convert I to appropriate color space (or simply normalize):
     const std::string& cs = pChns.pColor->colorSpace;
@@ -257,89 +394,152 @@ int Detector::chnsPyramid
 
     if (pI.channels())
     {
-        rgbConvert(pI, I, cs, true, m_isLuv);
+        rgbConvert(pI, I, cs, true, isLuv);
     }
 
     pChns.pColor->colorSpace = std::string("orig");
 
-    auto& info = pyramid.info;
-    auto& scales = pyramid.scales;
-    auto& scaleshw = pyramid.scaleshw;
+    PyramidWorkspace local;
+    auto& ws = workspace ? *workspace : local;
+    ws.allocations = 0;
+    ws.bytes = 0;
+    ws.plans = 0;
 
     // Get scales at which to compute features and list of real/approx scales:
-    getScales(nPerOct, nOctUp, minDs, shrink, sz, scales, scaleshw);
-
-    auto nScales = static_cast<int>(scales.size());
-    std::vector<int> isR, isA, isN(nScales, 0), *isRA[2] = { &isR, &isA };
-    for (int i = 0; i < nScales; i++)
+    // Levels outside the expected object size range (or the frame range) are skipped, unless
+    // lambdas have to be estimated from the full set of real scales (see below):
+    double minScale = 0.0, maxScale = std::numeric_limits<double>::max();
+    if (lambdas.size() || (nApprox <= 0))
     {
-        isRA[(i % (nApprox + 1)) > 0]->push_back(i + 1);
+        if (frame)
+        {
+            minScale = frame->minScale;
+            maxScale = frame->maxScale;
+        }
+        else
+        {
+            getScaleRange(minScale, maxScale);
+        }
     }
 
-    std::vector<int> isH((isR.size() + 1), 0);
-    isH.back() = nScales;
-    for (int i = 0; i < std::max(int(isR.size()) - 1, 0); i++)
+    const cv::Size frameSize = frame ? frame->size : cv::Size();
+    auto& plan = ws.plan;
+    if (!plan.matches(sz, nPerOct, nOctUp, nApprox, minDs, shrink, pad, minScale, maxScale, frameSize))
     {
-        isH[i + 1] = (isR[i] + isR[i + 1]) / 2;
+        createPlan(plan, sz, nPerOct, nOctUp, nApprox, minDs, shrink, pad, minScale, maxScale, frameSize);
+        ws.plans++;
     }
 
-    for (int i = 0; i < isR.size(); i++)
-    {
-        for (int j = isH[i]; j < isH[i + 1]; j++)
-        {
-            isN[j] = isR[i];
-        }
-    }
+    auto& info = pyramid.info;
+    auto& scales = pyramid.scales;
+    auto& scaleshw = pyramid.scaleshw;
+    scales = plan.scales;
+    scaleshw = plan.scaleshw;
+
+    auto nScales = static_cast<int>(scales.size());
+    const auto& isR = plan.isR;
+    const auto& isA = plan.isA;
+    const auto& isN = plan.isN;
+    const int nReal = static_cast<int>(isR.size());
 
-    // Compute image pyramid [real scales]
-    int nTypes = 0;
     auto& data = pyramid.data;
-    for (const auto& i : isR)
+    data.clear(); // release references to workspace buffers from a previous call
+    data.resize(nScales);
+    pyramid.pPyramid = pPyramid;
+    pyramid.nScales = nScales;
+    pyramid.nTypes = 0;
+
+    std::vector<int> kR(nScales, -1); // scale -> real scale index
+    for (int k = 0; k < nReal; k++)
     {
-        double s = scales[i - 1];
-        cv::Size sz1 = round((cv::Size2d(sz) * s) / double(shrink)) * shrink;
+        kR[isR[k] - 1] = k;
+    }
 
-        MatP I1;
-        if (sz == sz1)
+    // Real scales, lambda estimation and approximated scales are scheduled as task graphs.
+    // Channels at a real scale only wait for its resampled image (the s == 0.5 image is the
+    // source for all smaller real scales), lambda estimation waits for the two real scales
+    // it measures, and each approximated scale waits for its nearest real scale (+lambdas).
+    // Task ids of real scales persist across graphs: kPending means not yet scheduled, -1
+    // means computed by an earlier graph (which is also an empty dependency).
+    const int kPending = -2;
+    std::vector<MatP> images(nReal);
+    std::vector<int> resampleTask(nReal, kPending), chnsTask(nReal, kPending);
+    std::vector<std::size_t> allocations(nScales, 0), bytes(nScales, 0);
+    int lambdaTask = -1;
+    TaskGraph graph;
+
+    ws.resampled.resize(nReal);
+    ws.real.resize(nReal);
+    ws.chns.resize(nScales);
+    auto& chnsR = ws.real;
+    ws.timings.clear();
+
+    std::function<int(int)> addResample = [&](int k) -> int {
+        if (resampleTask[k] != kPending)
         {
-            I1 = I;
-        }
-        else
-        {
-            // TODO: use imResampleMex to resave remap coefficients
-            imResample(I, I1, sz1, 1.0);
+            return resampleTask[k];
         }
 
-        if ((s == 0.5) && ((nApprox > 0) || (nPerOct == 1)))
+        const int src = plan.imageSource[k];
+        const int dependency = (src < 0) ? -1 : addResample(src);
+        if (sz != plan.imageSizes[k])
         {
-            I = I1;
+            reserve(ws, ws.resampled[k], plan.imageSizes[k], I.depth(), I.channels());
         }
 
-        if ((i == isR.front()) && (MO.channels() == 2))
+        resampleTask[k] = graph.add([&, k, src]() {
+            const cv::Size& sz1 = plan.imageSizes[k];
+            const MatP& I0 = (src < 0) ? I : images[src];
+            if (sz == sz1)
+            {
+                images[k] = I0;
+            }
+            else
+            {
+                images[k] = ws.resampled[k];
+                imResample(I0, images[k], sz1, 1.0, plan.imageCoef[k].get());
+            }
+        }, { dependency });
+        return resampleTask[k];
+    };
+
+    auto addChns = [&](int k) -> int {
+        if (chnsTask[k] != kPending)
         {
-            I1.push_back(MO[0]);
-            I1.push_back(MO[1]);
+            return chnsTask[k];
         }
 
-        Detector::Channels chns;
-        chnsCompute(I1, pChns, chns, false, pLogger);
-        info = chns.info;
-        if (i == isR.front()) // on first iteration allocate data
-        {
-            nTypes = chns.nTypes;
-            data.resize(nScales);
-            for (auto& s : data)
+        chnsTask[k] = graph.add([&, k]() {
+            MatP I1 = images[k];
+            if ((k == 0) && (MO.channels() == 2))
             {
-                s.resize(nTypes);
+                I1.push_back(MO[0]);
+                I1.push_back(MO[1]);
             }
-        }
 
-        std::copy(chns.data.begin(), chns.data.end(), data[i - 1].begin());
-    }
+            // chnsCompute() reuses the planes of the previous call, and the ones it has to
+            // allocate are tallied for the level of this real scale:
+            std::vector<const uchar*> previous;
+            for (const auto& c : chnsR[k].data)
+            {
+                previous.push_back(c.base().data);
+            }
+            chnsCompute(I1, pChns, chnsR[k], false, pLogger);
+            for (const auto& c : chnsR[k].data)
+            {
+                if (std::find(previous.begin(), previous.end(), c.base().data) == previous.end())
+                {
+                    allocations[isR[k] - 1]++;
+                    bytes[isR[k] - 1] += c.base().total() * c.base().elemSize();
+                }
+            }
+        }, { addResample(k) });
+        return chnsTask[k];
+    };
 
     // If lambdas not specified compute image specific lambdas:
-    if (nScales > 0 && nApprox > 0 && !lambdas.size())
-    {
+    const bool doLambdas = (nScales > 0 && nApprox > 0 && !lambdas.size());
+    auto addLambdas = [&]() {
         std::vector<int> is;
         for (int i = (1 + nOctUp * nPerOct); i <= nScales; i += (nApprox + 1))
         {
@@ -353,90 +553,287 @@ int Detector::chnsPyramid
             is = { is[1], is[2] };
         }
 
-        std::vector<double> f0(nTypes, 0.0), f1 = f0;
-        for (int j = 0; j < nTypes; j++)
+        CV_Assert((kR[is[0]] >= 0) && (kR[is[1]] >= 0));
+
+        lambdaTask = graph.add([&, is]() {
+            const auto& chns0 = chnsR[kR[is[0]]];
+            const auto& chns1 = chnsR[kR[is[1]]];
+            const int nTypes = chns0.nTypes;
+
+            std::vector<double> f0(nTypes, 0.0), f1 = f0;
+            for (int j = 0; j < nTypes; j++)
+            {
+                f0[j] = sum(chns0.data[j]) / double(numel(chns0.data[j]));
+                CV_Assert(!std::isnan(f0[j]));
+            }
+
+            for (int j = 0; j < nTypes; j++)
+            {
+                f1[j] = sum(chns1.data[j]) / double(numel(chns1.data[j]));
+                CV_Assert(!std::isnan(f1[j]));
+            }
+
+            lambdas.resize(nTypes);
+            for (int j = 0; j < nTypes; j++)
+            {
+                lambdas[j] = -util::log2(f0[j] / f1[j]) / util::log2(scales[is[0]] / scales[is[1]]);
+            }
+        }, { addChns(kR[is[0]]), addChns(kR[is[1]]) });
+    };
+
+    // Approximated scale i (1 based); workspace usage is tallied per scale:
+    auto addApprox = [&](int i) {
+        const int k = kR[isN[i - 1] - 1];
+        graph.add([&, i, k]() {
+            const int iR = isN[i - 1];
+            const auto& chns = chnsR[k];
+            const cv::Size& sz1 = plan.chnsSizes[i - 1];
+            auto& approx = ws.chns[i - 1];
+            approx.resize(chns.nTypes);
+            for (int j = 0; j < chns.nTypes; j++)
+            {
+                reserve(allocations[i - 1], bytes[i - 1], approx[j], sz1, chns.data[j].depth(), chns.data[j].channels());
+                double ratio = std::pow(scales[i - 1] / scales[iR - 1], -lambdas[j]);
+                imResample(chns.data[j], approx[j], sz1, ratio, plan.chnsCoef[i - 1].get());
+            }
+        }, { addChns(k), lambdaTask });
+    };
+
+    auto runGraph = [&]() {
+        // Logger callbacks aren't required to be thread safe, so logging runs serially:
+        graph.run(!pLogger);
+        for (auto* tasks : { &resampleTask, &chnsTask })
         {
-            f0[j] = sum(data[is[0]][j]) / double(numel(data[is[0]][j]));
-            CV_Assert(!std::isnan(f0[j]));
+            for (auto& task : *tasks)
+            {
+                task = (task == kPending) ? kPending : -1;
+            }
         }
+        lambdaTask = -1;
+    };
 
-        for (int j = 0; j < nTypes; j++)
+    // Gather the channels for a set of (0 based) levels, then smooth, pad and concatenate:
+    auto finishLevels = [&](const std::vector<int>& levels) {
+        for (const auto& i : levels)
         {
-            f1[j] = sum(data[is[1]][j]) / double(numel(data[is[1]][j]));
-            CV_Assert(!std::isnan(f1[j]));
+            if (kR[i] >= 0)
+            {
+                data[i] = chnsR[kR[i]].data;
+                info = chnsR[kR[i]].info;
+            }
+            else
+            {
+                data[i] = ws.chns[i];
+            }
+            ws.allocations += allocations[i];
+            ws.bytes += bytes[i];
         }
 
-        lambdas.resize(nTypes);
-        for (int j = 0; j < nTypes; j++)
+        const int nTypes = static_cast<int>(data[levels.front()].size());
+        pyramid.nTypes = nTypes;
+        pyramid.lambdas = lambdas;
+
+        // The per scale/type operations vary in cost with the level area (by up to 64x), so
+        // they are scheduled by estimated cost (area x channels) rather than uniform slicing:
+        std::vector<double> costs(levels.size(), 0.0);
+        for (int l = 0; l < levels.size(); l++)
         {
-            lambdas[j] = -util::log2(f0[j] / f1[j]) / util::log2(scales[is[0]] / scales[is[1]]);
+            int nChns = 0;
+            for (const auto& c : data[levels[l]])
+            {
+                nChns += c.channels();
+            }
+            costs[l] = double(plan.paddedSizes[levels[l]].area()) * double(nChns);
         }
-    }
-
-    // The per scale/type operations are easily parallelized, but with a parallel_for approach
-    // using simple uniform slicing will tend to starve some threads due to the nature of the
-    // pyramid layout.  Randomizing the scale indices should do better.  More optimal strategies
-    // may exist with further testing (work stealing, etc).
-    const auto scalesIndex = acf::create_random_indices(nScales);
 
-    auto isAIndex = isA;
-    std::shuffle(isAIndex.begin(), isAIndex.end(), std::mt19937(std::random_device()()));
+        auto schedule = [&](const char* stage, const std::function<void(int)>& task) {
+            TaskScheduler scheduler(stage);
+            scheduler.run(costs, [&](int l) { task(levels[l]); });
+            for (auto timing : scheduler.timings())
+            {
+                timing.task = levels[timing.task];
+                ws.timings.push_back(timing);
+            }
+        };
 
-    cv::parallel_for_({ 0, int(isAIndex.size()) }, [&](const cv::Range& r) {
-        for (int k = r.start; k < r.end; k++)
-        {
-            const int i = isAIndex[k];
-            const int iR = isN[i - 1];
-            const cv::Size sz1 = round(cv::Size2d(sz) * scales[i - 1] / double(shrink));
+        schedule("smooth", [&](int i) {
             for (int j = 0; j < nTypes; j++)
             {
-                double ratio = std::pow(scales[i - 1] / scales[iR - 1], -lambdas[j]);
-                imResample(data[iR - 1][j], data[i - 1][j], sz1, ratio);
+                convTri(data[i][j], data[i][j], smooth, 1);
             }
-        }
-    });
+        });
 
-    cv::parallel_for_({ 0, int(scales.size()) }, [&](const cv::Range& r) {
-        for (int i = r.start; i < r.end; i++)
+        // Padding and concatenation are combined in a single copy to the output buffers, which
+        // also converts the channels for a uint8 or half precision pyramid (see setDoUint8()
+        // and setDoHalf()):
+        const int x = plan.border.x, y = plan.border.y;
+        CV_Assert(!(m_doUint8 || m_doHalf) || concat);
+        CV_Assert(!(m_doUint8 && m_doHalf));
+        const int depth = m_doUint8 ? CV_8U : (m_doHalf ? CV_16F : -1);
+        if (concat && nTypes)
         {
-            for (int j = 0; j < nTypes; j++)
+            ws.fused.resize(nScales);
+            for (const auto& i : levels)
             {
-                convTri(data[scalesIndex[i]][j], data[scalesIndex[i]][j], smooth, 1);
+                int nChns = 0;
+                for (const auto& c : data[i])
+                {
+                    CV_Assert(c.size() == plan.chnsSizes[i]);
+                    nChns += c.channels();
+                }
+                reserve(ws, ws.fused[i], plan.paddedSizes[i], (depth < 0) ? data[i][0].depth() : depth, nChns);
             }
-        }
-    });
 
-    // TODO: test imPad
-    if (pad.width || pad.height)
-    {
-        cv::parallel_for_({ 0, int(scales.size()) }, [&](const cv::Range& r) {
-            for (int i = r.start; i < r.end; i++)
+            schedule("concat", [&](int i) {
+                auto& fused = ws.fused[i];
+                cv::Mat converted;
+                int k = 0;
+                for (const auto& c : data[i])
+                {
+                    for (const auto& plane : c)
+                    {
+                        if (fused.depth() != plane.depth())
+                        {
+                            plane.convertTo(converted, fused.depth(), (fused.depth() == CV_8U) ? 255.0 : 1.0);
+                            cv::copyMakeBorder(converted, fused[k++], y, y, x, x, cv::BORDER_REFLECT);
+                        }
+                        else
+                        {
+                            cv::copyMakeBorder(plane, fused[k++], y, y, x, x, cv::BORDER_REFLECT);
+                        }
+                    }
+                }
+            });
+
+            for (const auto& i : levels)
             {
+                data[i].resize(1);
+                data[i][0] = ws.fused[i];
+            }
+        }
+        else if (x || y)
+        {
+            // TODO: test imPad
+            ws.padded.resize(nScales);
+            for (const auto& i : levels)
+            {
+                ws.padded[i].resize(nTypes);
                 for (int j = 0; j < nTypes; j++)
                 {
-                    int y = pad.height / shrink;
-                    int x = pad.width / shrink;
-                    auto& I = data[scalesIndex[i]][j];
-                    copyMakeBorder(I, I, y, y, x, x, cv::BORDER_REFLECT);
+                    const auto& I = data[i][j];
+                    CV_Assert(I.size() == plan.chnsSizes[i]);
+                    reserve(ws, ws.padded[i][j], plan.paddedSizes[i], I.depth(), I.channels());
                 }
             }
-        });
-    }
 
-    if (concat && nTypes)
+            schedule("pad", [&](int i) {
+                for (int j = 0; j < nTypes; j++)
+                {
+                    auto& I = data[i][j];
+                    copyMakeBorder(I, ws.padded[i][j], y, y, x, x, cv::BORDER_REFLECT);
+                    I = ws.padded[i][j];
+                }
+            });
+        }
+    };
+
+    if (!sink)
     {
-        auto data0 = data;
-        data.resize(nScales);
-        for (int i = 0; i < nScales; i++)
+        // Compute the full pyramid:
+        for (int k = 0; k < nReal; k++)
+        {
+            addChns(k);
+        }
+        if (doLambdas)
+        {
+            addLambdas();
+        }
+        for (const auto& i : isA)
         {
-            data[i].resize(1);
-            fuseChannels(data0[i].begin(), data0[i].end(), data[i][0]);
+            addApprox(i);
+        }
+        runGraph();
+
+        if (nScales)
+        {
+            std::vector<int> levels(nScales);
+            std::iota(levels.begin(), levels.end(), 0);
+            finishLevels(levels);
         }
     }
+    else
+    {
+        // Stream one group of levels (a real scale and the scales approximated from it) at a
+        // time.  Each group is handed to the sink and then released, so only the current group,
+        // the half scale source image and (for lambda estimation) two real scales are live.
+        // With a time budget the groups run from the coarsest (cheapest) scale to the finest,
+        // and the groups left when it runs out are skipped (see Detector::setTimeBudget()).
+        if (doLambdas)
+        {
+            addLambdas();
+            runGraph();
+        }
+
+        std::vector<bool> isSource(nReal, false);
+        for (const auto& src : plan.imageSource)
+        {
+            if (src >= 0)
+            {
+                isSource[src] = true;
+            }
+        }
+
+        const bool isCoarseFirst = (m_timeBudget > 0.0);
+        for (int n = 0; n < nReal; n++)
+        {
+            const int k = isCoarseFirst ? (nReal - 1 - n) : n;
+            const auto& levels = plan.groups[k];
+            if (isPastDeadline())
+            {
+                for (const auto& i : levels)
+                {
+                    m_skippedScales.push_back(scales[i]);
+                }
+                continue;
+            }
+
+            addChns(k);
+            for (const auto& i : levels)
+            {
+                if (kR[i] < 0)
+                {
+                    addApprox(i + 1);
+                }
+            }
+            runGraph();
+            finishLevels(levels);
+
+            sink(pyramid, levels);
+
+            for (const auto& i : levels)
+            {
+                data[i].clear();
+                ws.chns[i].clear();
+                if (i < ws.fused.size())
+                {
+                    ws.fused[i] = MatP();
+                }
+                if (i < ws.padded.size())
+                {
+                    ws.padded[i].clear();
+                }
+            }
+            chnsR[k] = {};
+            if (!isSource[k])
+            {
+                images[k] = MatP();
+                ws.resampled[k] = MatP();
+            }
+        }
+
+        ws.resampled.clear();
+    }
 
-    pyramid.pPyramid = pPyramid;
-    pyramid.nTypes = nTypes;
-    pyramid.nScales = nScales;
     pyramid.lambdas = lambdas;
 
 #define DO_DEBUG_CONCATENATED_FEATURES 0
@@ -466,7 +863,10 @@ int Detector::getScales
     int shrink,
     const cv::Size& sz,
     DoubleVec& scales,
-    Size2dVec& scaleshw
+    Size2dVec& scaleshw,
+    double minScale,
+    double maxScale,
+    int nApprox
 )
 {
     // set each scale s such that max(abs(round(sz*s/shrink)*shrink-sz*s)) is
@@ -525,6 +925,33 @@ int Detector::getScales
         }
     }
 
+    // Keep scales in [minScale, maxScale] (decreasing order), extended to the enclosing real
+    // scales (every nApprox+1) so that each kept level is computed as in the full pyramid.
+    // (Real scales below 0.5 are resampled from the input if the 0.5 level is not kept.)
+    const int n = static_cast<int>(scales.size()), step = std::max(nApprox + 1, 1);
+    int i0 = 0, i1 = n - 1;
+    while ((i0 < n) && (scales[i0] > maxScale))
+    {
+        i0++;
+    }
+    while ((i1 >= 0) && (scales[i1] < minScale))
+    {
+        i1--;
+    }
+
+    if (i0 > i1)
+    {
+        scales.clear();
+        scaleshw.clear();
+    }
+    else if ((i0 > 0) || (i1 < (n - 1)))
+    {
+        i0 = (i0 / step) * step;
+        i1 = std::min(((i1 + step - 1) / step) * step, n - 1);
+        scales = DoubleVec(scales.begin() + i0, scales.begin() + i1 + 1);
+        scaleshw = Size2dVec(scaleshw.begin() + i0, scaleshw.begin() + i1 + 1);
+    }
+
     return 0;
 }
 
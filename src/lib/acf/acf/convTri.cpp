@@ -241,9 +241,14 @@ int Detector::convTri(const MatP& I, MatP& J, double r, int s)
             f = cv::Mat(k);
         }
 
-        for (auto& j : J)
+        if (&J != &I)
         {
-            cv::sepFilter2D(j, j, j.type(), f, f.t());
+            J.create(I.size(), I.depth(), I.channels());
+        }
+
+        for (int i = 0; i < I.channels(); i++)
+        {
+            cv::sepFilter2D(I[i], J[i], J[i].type(), f, f.t());
         }
 
         // TODO:
@@ -30,11 +30,13 @@ sugar_files(ACF_SRCS
   ### Toolbox sources ###
   #######################  
   toolbox/acfDetect1.cpp
+  toolbox/chnsFused.cpp
   toolbox/convConst.cpp
   toolbox/gradientMex.cpp
   toolbox/imPadMex.cpp
   toolbox/imResampleMex.cpp
   toolbox/rgbConvertMex.cpp
+  toolbox/simd.cpp
   toolbox/wrappers.cpp
 )
 
@@ -43,10 +45,16 @@ sugar_files(ACF_HDRS
   ACFIOArchive.h
   ACFObject.h
   ObjectDetector.h
-  random.h
+  tasks.h
   #######################
   ### Toolbox headers ###
   #######################  
+  toolbox/convConstKernels.hpp
+  toolbox/gradientMexKernels.hpp
+  toolbox/imResampleKernels.hpp
+  toolbox/rgbConvertKernels.hpp
+  toolbox/simd.hpp
+  toolbox/simdDispatch.hpp
   toolbox/sse.hpp
   toolbox/wrappers.hpp
   )
@@ -0,0 +1,267 @@
+/*! -*-c++-*-
+  @file   tasks.h
+  @author David Hirvonen
+  @brief  Private header for dependency aware task execution.
+
+  \copyright Copyright 2018 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#ifndef __acf_tasks_h__
+#define __acf_tasks_h__
+
+#include <acf/ACF.h>
+#include <acf/acf_common.h>
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+ACF_NAMESPACE_BEGIN
+
+// A small DAG of tasks executed on the cv::parallel_for_ thread pool.  Each worker pulls
+// ready tasks from a shared queue and completing a task releases its dependents, so
+// independent work runs concurrently while ordering constraints are respected.  Workers
+// only block while some other worker is running a task, so the graph also completes when
+// parallel_for_ runs the workers serially (e.g., nested parallelism or a single thread).
+class TaskGraph
+{
+public:
+    using Task = std::function<void()>;
+
+    // Add a task that runs after all listed dependencies (negative ids are ignored):
+    int add(Task task, const std::vector<int>& dependencies = {})
+    {
+        const int id = static_cast<int>(m_nodes.size());
+        m_nodes.push_back({ std::move(task), {}, 0 });
+        for (const auto& d : dependencies)
+        {
+            if (d >= 0)
+            {
+                CV_Assert(d < id);
+                m_nodes[d].dependents.push_back(id);
+                m_nodes[id].pending++;
+            }
+        }
+        return id;
+    }
+
+    std::size_t size() const
+    {
+        return m_nodes.size();
+    }
+
+    // Execute all tasks; the first exception thrown by a task is rethrown here and the
+    // remaining tasks are skipped.  If parallel == false tasks run on the calling thread in
+    // the order they were added (dependencies are always added first).
+    void run(bool parallel = true)
+    {
+        if (!parallel)
+        {
+            auto nodes = std::move(m_nodes);
+            m_nodes.clear();
+            for (auto& node : nodes)
+            {
+                node.task();
+            }
+            return;
+        }
+
+        std::deque<int> ready;
+        for (int i = 0; i < m_nodes.size(); i++)
+        {
+            if (m_nodes[i].pending == 0)
+            {
+                ready.push_back(i);
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+        auto remaining = m_nodes.size();
+
+        const int nWorkers = std::max(std::min(cv::getNumThreads(), int(m_nodes.size())), 1);
+        cv::parallel_for_({ 0, nWorkers }, [&](const cv::Range& r) {
+            for (int w = r.start; w < r.end; w++)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (true)
+                {
+                    done.wait(lock, [&]() { return !ready.empty() || (remaining == 0); });
+                    if (remaining == 0)
+                    {
+                        break;
+                    }
+
+                    const int id = ready.front();
+                    ready.pop_front();
+                    const bool skip = static_cast<bool>(error);
+
+                    lock.unlock();
+                    std::exception_ptr failure;
+                    if (!skip)
+                    {
+                        try
+                        {
+                            m_nodes[id].task();
+                        }
+                        catch (...)
+                        {
+                            failure = std::current_exception();
+                        }
+                    }
+                    lock.lock();
+
+                    if (failure && !error)
+                    {
+                        error = failure;
+                    }
+
+                    remaining--;
+                    for (const auto& d : m_nodes[id].dependents)
+                    {
+                        if (--m_nodes[d].pending == 0)
+                        {
+                            ready.push_back(d);
+                        }
+                    }
+                    done.notify_all();
+                }
+            }
+        });
+
+        m_nodes.clear();
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+protected:
+    struct Node
+    {
+        Task task;
+        std::vector<int> dependents;
+        int pending;
+    };
+
+    std::vector<Node> m_nodes;
+};
+
+// Cost driven scheduling of independent tasks with work stealing.  Tasks are dealt to
+// per worker queues in decreasing order of estimated cost, each time to the worker with
+// the least accumulated cost (longest processing time first), so the initial schedule is
+// a deterministic function of the costs and the worker count.  Workers run their own
+// queue from the most expensive task down; a worker that runs dry steals the cheapest
+// remaining task of the most loaded worker, which absorbs errors in the cost model.
+class TaskScheduler
+{
+public:
+    using Timing = Detector::TaskTiming;
+
+    TaskScheduler(const char* stage, int nWorkers = cv::getNumThreads())
+        : m_stage(stage)
+        , m_nWorkers(std::max(nWorkers, 1))
+    {
+    }
+
+    // Run task(i) for each i in [0, costs.size()), on the calling thread if parallel == false:
+    void run(const std::vector<double>& costs, const std::function<void(int)>& task, bool parallel = true)
+    {
+        const int n = static_cast<int>(costs.size());
+        m_timings.assign(n, {});
+        if (n == 0)
+        {
+            return;
+        }
+
+        std::vector<int> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return costs[a] > costs[b]; });
+
+        const int nWorkers = parallel ? std::min(m_nWorkers, n) : 1;
+        std::vector<std::deque<int>> queues(nWorkers);
+        std::vector<double> load(nWorkers, 0.0);
+        for (const auto& i : order)
+        {
+            const auto w = std::distance(load.begin(), std::min_element(load.begin(), load.end()));
+            queues[w].push_back(i);
+            load[w] += costs[i];
+        }
+
+        std::mutex mutex;
+        cv::parallel_for_({ 0, nWorkers }, [&](const cv::Range& r) {
+            for (int w = r.start; w < r.end; w++)
+            {
+                while (true)
+                {
+                    int i = -1;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        int victim = queues[w].empty() ? -1 : w;
+                        for (int v = 0; queues[w].empty() && (v < nWorkers); v++)
+                        {
+                            if (!queues[v].empty() && ((victim < 0) || (load[v] > load[victim])))
+                            {
+                                victim = v;
+                            }
+                        }
+                        if (victim < 0)
+                        {
+                            break;
+                        }
+
+                        auto& queue = queues[victim];
+                        if (victim == w)
+                        {
+                            i = queue.front();
+                            queue.pop_front();
+                        }
+                        else
+                        {
+                            i = queue.back();
+                            queue.pop_back();
+                        }
+                        load[victim] -= costs[i];
+                    }
+
+                    const auto tic = std::chrono::high_resolution_clock::now();
+                    task(i);
+                    const auto toc = std::chrono::high_resolution_clock::now();
+                    auto& timing = m_timings[i];
+                    timing.stage = m_stage;
+                    timing.task = i;
+                    timing.worker = w;
+                    timing.cost = costs[i];
+                    timing.seconds = std::chrono::duration<double>(toc - tic).count();
+                }
+            }
+        });
+    }
+
+    // Timing for each task of the last run() (indexed by task):
+    const std::vector<Timing>& timings() const
+    {
+        return m_timings;
+    }
+
+protected:
+    const char* m_stage;
+    int m_nWorkers;
+    std::vector<Timing> m_timings;
+};
+
+ACF_NAMESPACE_END
+
+#endif // __acf_tasks_h__
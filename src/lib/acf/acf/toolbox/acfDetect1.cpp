@@ -8,6 +8,7 @@
 #include <acf/ACF.h>
 #include <acf/MatP.h>
 #include <acf/acf_common.h>
+#include <acf/tasks.h>
 
 #include <opencv2/core/base.hpp>
 #include <opencv2/core/hal/interface.h>
@@ -16,9 +17,40 @@
 #include <opencv2/core/types.hpp>
 #include <opencv2/core/utility.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <assert.h>
 
+// clang-format off
+#if defined(ANDROID)
+#  define HALF_ENABLE_CPP11_CMATH 0
+#endif
+#if ACF_DO_HALF
+#  include "half/half.hpp"
+#endif
+// clang-format on
+
+// Vectorized depth 2 cascade evaluation (see ParallelDetectionBodySIMD):
+#if defined(__arm64) || defined(__ARM_NEON__) || defined(ANDROID)
+#  include <arm_neon.h>
+#  define ACF_DETECT_NEON 1
+#elif defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#  include <immintrin.h>
+#  define ACF_DETECT_AVX2 1
+#  if defined(__GNUC__) || defined(__clang__)
+#    define ACF_TARGET_AVX2 __attribute__((target("avx2")))
+#  else
+#    define ACF_TARGET_AVX2
+#  endif
+#endif
+
 using namespace std;
 
 using uint32 = unsigned int;
@@ -39,13 +71,150 @@ static UInt32Vec computeChannelIndexColMajor(int nChns, int modelWd, int modelHt
 class DetectionSink
 {
 public:
+    using Hit = std::pair<cv::Point, float>;
+
     virtual void add(const cv::Point& p, float value)
     {
-        hits.emplace_back(p, value);
+        if (!capacity)
+        {
+            hits.emplace_back(p, value);
+            return;
+        }
+
+        // Bounded: keep a min heap of the best capacity hits (see Detector::setMaxCandidateCount())
+        if (value < bound->load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        if (hits.size() < capacity)
+        {
+            hits.emplace_back(p, value);
+            std::push_heap(hits.begin(), hits.end(), isBetter);
+        }
+        else if (value > hits.front().second)
+        {
+            std::pop_heap(hits.begin(), hits.end(), isBetter);
+            hits.back() = { p, value };
+            std::push_heap(hits.begin(), hits.end(), isBetter);
+        }
+        else
+        {
+            return;
+        }
+
+        // A full heap bounds the global capacity-th best score from below:
+        if (hits.size() == capacity)
+        {
+            const float floor = hits.front().second - margin;
+            float current = bound->load(std::memory_order_relaxed);
+            while ((floor > current) && !bound->compare_exchange_weak(current, floor, std::memory_order_relaxed))
+            {
+            }
+        }
+    }
+
+    static bool isBetter(const Hit& a, const Hit& b)
+    {
+        return a.second > b.second;
     }
-    std::vector<std::pair<cv::Point, float>> hits;
+
+    std::vector<Hit> hits;
+    std::size_t evaluated = 0; // number of windows scanned
+
+    std::size_t capacity = 0;            // 0 = unbounded
+    float margin = 0.f;                  // score margin below the capacity-th best
+    std::atomic<float>* bound = nullptr; // shared: hits below this score can't be kept
 };
 
+using DetectionSinkVec = std::vector<DetectionSink>;
+
+// Shared state for bounded scans of one or more levels (see DetectionSink):
+struct DetectionBound
+{
+    DetectionBound(std::size_t capacity, double margin)
+        : capacity(capacity)
+        , margin(static_cast<float>(margin))
+        , bound(-std::numeric_limits<float>::infinity())
+    {
+    }
+
+    void init(DetectionSinkVec& sinks)
+    {
+        for (auto& sink : sinks)
+        {
+            sink.capacity = capacity;
+            sink.margin = margin;
+            sink.bound = &bound;
+        }
+    }
+
+    // Keep the best capacity detections, plus any within margin of the capacity-th best:
+    void prune(std::vector<Detector::DetectionVec>& objects) const
+    {
+        std::vector<double> scores;
+        for (const auto& level : objects)
+        {
+            for (const auto& bb : level)
+            {
+                scores.push_back(bb.score);
+            }
+        }
+
+        if (!capacity || (scores.size() <= capacity))
+        {
+            return;
+        }
+
+        std::nth_element(scores.begin(), scores.begin() + (capacity - 1), scores.end(), std::greater<double>());
+        const double floor = scores[capacity - 1] - margin;
+        for (auto& level : objects)
+        {
+            level.erase(std::remove_if(level.begin(), level.end(), [&](const Detector::Detection& bb) {
+                return bb.score < floor;
+            }),
+                level.end());
+        }
+    }
+
+    std::size_t capacity;
+    float margin;
+    std::atomic<float> bound;
+};
+
+// Scan tiles are specified in units of detection windows (i.e., size1 coordinates).
+// The tile size is chosen so that the channel footprint for all windows in a tile
+// (tile extent plus one model extent in each dimension) fits in a conservative L2
+// budget, and each tile is an independent unit of work for the parallel scan.
+static RectVec computeTiles(const cv::Size& size1, const cv::Size& winSize, int stride, int shrink, int nChns, int elemSize);
+
+// Compiled tree node: the split feature, threshold, leaf value and child link are
+// interleaved in one 16 byte record, so that each node visit touches a single cache
+// line.  Nodes are stored breadth first (the training order) and each tree is padded
+// to a whole number of cache lines.  See Detector::Classifier::compile().
+struct CompiledNode
+{
+    uint32_t cid; // model: feature index, detector: resolved channel offset
+    float thr;    // split threshold (x255 for uint8_t input)
+    float hs;     // leaf value
+    uint32_t child;
+};
+
+static const int kNodesPerCacheLine = 64 / sizeof(CompiledNode);
+
+#if ACF_DO_HALF
+// Half precision (CV_16F) channel value, widened to float on load:
+struct half
+{
+    operator float() const
+    {
+        return half_float::detail::half2float(bits);
+    }
+
+    half_float::detail::uint16 bits;
+};
+#endif
+
 class DetectionParams : public cv::ParallelLoopBody
 {
 public:
@@ -55,62 +224,144 @@ public:
     int stride{};
     int shrink{};
     int rowStride{};
-    std::vector<uint32_t> cids;
-    const uint32* fids{};
-    const float* hs = nullptr;
     int nTrees{};
     int nTreeNodes{};
     float cascThr{};
-    const uint32_t* child = nullptr;
+    int coarseStep = 1;     // coarse to fine: lattice spacing of the first pass in windows (1 = dense)
+    float coarseMargin = 0; // coarse to fine: threshold relaxation of the first pass
+
+    cv::Mat nodes;                        // compiled trees with channel offsets resolved for this level
+    const CompiledNode* trees = nullptr;  // nodes.data
+    int nodeStride{};                     // nodes per (padded) tree
 
     MatP I;
     cv::Mat canvas;
 
+    RectVec tiles;                  // scan tiles in window (size1) coordinates
+    DetectionSink* sinks = nullptr; // optional: one sink per tile for lock free parallel scans
+
+    // Scan the windows of a tile on a lattice with spacing step using threshold thr:
+    virtual void scan(const cv::Rect& tile, const cv::Point& step, float thr, DetectionSink* sink1) const = 0;
     virtual float evaluate(uint32_t row, uint32_t col) const = 0;
+
+    void scanTile(const cv::Rect& tile, DetectionSink* sink1) const
+    {
+        if (coarseStep > 1)
+        {
+            scanCoarseToFine(tile, sink1);
+        }
+        else
+        {
+            scan(tile, step1, cascThr, sink1);
+        }
+    }
+
+    // Scan every coarseStep-th window with the threshold relaxed by coarseMargin, then
+    // evaluate the windows within coarseStep - 1 of each survivor at full resolution.  Any
+    // window that passes cascThr also passes the relaxed threshold, so detections on the
+    // lattice are exact, and the others are found when a lattice neighbour in the same
+    // tile survives (neighbourhoods are clipped to the tile so each window is scanned once).
+    void scanCoarseToFine(const cv::Rect& tile, DetectionSink* sink1) const
+    {
+        DetectionSink coarse;
+        scan(tile, step1 * coarseStep, cascThr - coarseMargin, &coarse);
+        sink1->evaluated += coarse.evaluated;
+
+        // Window grid of the tile, with the coarse lattice marked as visited:
+        const int cols = (tile.width + step1.x - 1) / step1.x;
+        const int rows = (tile.height + step1.y - 1) / step1.y;
+        std::vector<uint8_t> visited(cols * rows, 0);
+        for (int x = 0; x < cols; x += coarseStep)
+        {
+            for (int y = 0; y < rows; y += coarseStep)
+            {
+                visited[x * rows + y] = 1;
+            }
+        }
+
+        auto add = [&](int x, int y, float h) {
+            if (h > cascThr)
+            {
+                sink1->add({ tile.x + x * step1.x, tile.y + y * step1.y }, h);
+            }
+        };
+
+        const int radius = coarseStep - 1;
+        for (const auto& hit : coarse.hits)
+        {
+            const int x0 = (hit.first.x - tile.x) / step1.x;
+            const int y0 = (hit.first.y - tile.y) / step1.y;
+
+            // Survivors of the relaxed cascade may have been rejected by cascThr:
+            if (coarseMargin > 0.f)
+            {
+                add(x0, y0, evaluate(hit.first.y, hit.first.x));
+                sink1->evaluated++;
+            }
+            else
+            {
+                add(x0, y0, hit.second);
+            }
+
+            for (int x = std::max(x0 - radius, 0); x <= std::min(x0 + radius, cols - 1); x++)
+            {
+                for (int y = std::max(y0 - radius, 0); y <= std::min(y0 + radius, rows - 1); y++)
+                {
+                    if (!visited[x * rows + y])
+                    {
+                        visited[x * rows + y] = 1;
+                        add(x, y, evaluate(tile.y + y * step1.y, tile.x + x * step1.x));
+                        sink1->evaluated++;
+                    }
+                }
+            }
+        }
+    }
 };
 
 template <class T, int kDepth>
 class ParallelDetectionBody : public DetectionParams
 {
 public:
-    ParallelDetectionBody(const T* chns, const T* thrs, DetectionSink* sink)
+    ParallelDetectionBody(const T* chns, DetectionSink* sink)
         : chns(chns)
-        , thrs(thrs)
         , sink(sink)
     {
-        CV_Assert(thrs);
     }
 
+    // Range is specified in tile indices:
     void operator()(const cv::Range& range) const override
     {
-        for (int c = 0; c < size1.width; c += step1.x)
+        for (int t = range.start; t < range.end; t++)
         {
-            for (int r = 0; r < size1.height; r += step1.y)
+            scanTile(tiles[t], sinks ? &sinks[t] : sink);
+        }
+    }
+
+    void scan(const cv::Rect& tile, const cv::Point& step, float thr, DetectionSink* sink1) const override
+    {
+        std::size_t count = 0;
+        for (int c = tile.x; c < tile.x + tile.width; c += step.x)
+        {
+            for (int r = tile.y; r < tile.y + tile.height; r += step.y, count++)
             {
                 int offset = (r * stride / shrink) + (c * stride / shrink) * rowStride;
-                float h = evaluate(chns + offset);
-                if (h > cascThr)
+                float h = evaluate(chns + offset, 0, 0.f, thr);
+                if (h > thr)
                 {
-                    sink->add({ c, r }, h);
+                    sink1->add({ c, r }, h);
                 }
             }
         }
+        sink1->evaluated += count;
     }
 
-    void getChild(const T* chns1, uint32 offset, uint32& k0, uint32& k) const
-    {
-        int index = cids[fids[k]];
-        float ftr = chns1[index];
-        k = (ftr < thrs[k]) ? 1 : 2;
-        k0 = k += k0 * 2;
-        k += offset;
-    }
-
-    void traverse(const T* chns1, uint32_t offset, uint32_t& k0, uint32_t& k) const
+    void traverse(const T* chns1, const CompiledNode* tree, uint32_t& k) const
     {
         for (int i = 0; i < kDepth; i++)
         {
-            getChild(chns1, offset, k0, k);
+            const CompiledNode& node = tree[k];
+            k = (k * 2) + ((chns1[node.cid] < node.thr) ? 1 : 2);
         }
     }
 
@@ -122,14 +373,19 @@ public:
 
     float evaluate(const T* chns1) const
     {
-        float h = 0.f;
-        uint32_t isZero = (kDepth == 0);
-        for (int t = 0; t < nTrees; t++)
+        return evaluate(chns1, 0, 0.f, cascThr);
+    }
+
+    // Continue evaluation at tree t0 from the partial score h (early rejection at thr):
+    float evaluate(const T* chns1, int t0, float h, float thr) const
+    {
+        const CompiledNode* tree = trees + t0 * nodeStride;
+        for (int t = t0; t < nTrees; t++, tree += nodeStride)
         {
-            uint32 offset = t * nTreeNodes, k = offset, k0 = (k * isZero);
-            traverse(chns1, offset, k0, k);
-            h += hs[k];
-            if (h <= cascThr)
+            uint32_t k = 0;
+            traverse(chns1, tree, k);
+            h += tree[k].hs;
+            if (h <= thr)
             {
                 break;
             }
@@ -139,32 +395,256 @@ public:
 
     // Input params:
     const T* chns = nullptr;
-    const T* thrs = nullptr;
     DetectionSink* sink = nullptr;
 };
 
+// Variable depth trees: child is the (1 based) index of the left child, 0 for leaves
 template <>
-void ParallelDetectionBody<float, 0>::traverse(const float* chns1, uint32_t offset, uint32_t& k0, uint32_t& k) const
+void ParallelDetectionBody<float, 0>::traverse(const float* chns1, const CompiledNode* tree, uint32_t& k) const
 {
-    while (child[k])
+    while (tree[k].child)
     {
-        float ftr = chns1[cids[fids[k]]];
-        k = (ftr < thrs[k]) ? 1 : 0;
-        k0 = k = child[k0] - k + offset;
+        const CompiledNode& node = tree[k];
+        k = node.child - ((chns1[node.cid] < node.thr) ? 1 : 0);
     }
 }
 
 template <>
-void ParallelDetectionBody<uint8_t, 0>::traverse(const uint8_t* chns1, uint32_t offset, uint32_t& k0, uint32_t& k) const
+void ParallelDetectionBody<uint8_t, 0>::traverse(const uint8_t* chns1, const CompiledNode* tree, uint32_t& k) const
 {
-    while (child[k])
+    while (tree[k].child)
     {
-        float ftr = chns1[cids[fids[k]]];
-        k = (ftr < thrs[k]) ? 1 : 0;
-        k0 = k = child[k0] - k + offset;
+        const CompiledNode& node = tree[k];
+        k = node.child - ((chns1[node.cid] < node.thr) ? 1 : 0);
     }
 }
 
+#if ACF_DO_HALF
+template <>
+void ParallelDetectionBody<half, 0>::traverse(const half* chns1, const CompiledNode* tree, uint32_t& k) const
+{
+    while (tree[k].child)
+    {
+        const CompiledNode& node = tree[k];
+        k = node.child - ((chns1[node.cid] < node.thr) ? 1 : 0);
+    }
+}
+#endif
+
+#if ACF_DETECT_AVX2 || ACF_DETECT_NEON
+
+// Evaluate kLanes neighboring windows (along the contiguous channel dimension) through
+// each depth 2 tree together: the feature and node lookups are gathers, the child is
+// selected with a compare, and a lane mask freezes the score of each window as soon as
+// it falls below the threshold.  Once fewer than kMinLanes windows survive the remaining ones
+// are finished with the scalar evaluator.  Scores are identical to the scalar path.
+class ParallelDetectionBodySIMD : public ParallelDetectionBody<float, 2>
+{
+public:
+#if ACF_DETECT_AVX2
+    static const int kLanes = 8;
+#else
+    static const int kLanes = 4;
+#endif
+    static const int kMinLanes = 2;
+
+    ParallelDetectionBodySIMD(const float* chns, DetectionSink* sink)
+        : ParallelDetectionBody<float, 2>(chns, sink)
+    {
+    }
+
+    static bool isSupported()
+    {
+#if ACF_DETECT_AVX2
+        return cv::checkHardwareSupport(CV_CPU_AVX2);
+#else
+        return true;
+#endif
+    }
+
+    void scan(const cv::Rect& tile, const cv::Point& step, float thr, DetectionSink* sink1) const override
+    {
+        std::size_t count = 0;
+        const int rEnd = tile.y + tile.height;
+        for (int c = tile.x; c < tile.x + tile.width; c += step.x)
+        {
+            const int colOffset = (c * stride / shrink) * rowStride;
+
+            int r = tile.y;
+            for (; (r + (kLanes - 1) * step.y) < rEnd; r += kLanes * step.y, count += kLanes)
+            {
+                alignas(32) int offsets[kLanes];
+                alignas(32) float scores[kLanes];
+                for (int i = 0; i < kLanes; i++)
+                {
+                    offsets[i] = ((r + i * step.y) * stride / shrink) + colOffset;
+                }
+
+                evaluateLanes(offsets, scores, thr);
+
+                for (int i = 0; i < kLanes; i++)
+                {
+                    if (scores[i] > thr)
+                    {
+                        sink1->add({ c, r + i * step.y }, scores[i]);
+                    }
+                }
+            }
+
+            for (; r < rEnd; r += step.y, count++)
+            {
+                float h = evaluate(chns + (r * stride / shrink) + colOffset, 0, 0.f, thr);
+                if (h > thr)
+                {
+                    sink1->add({ c, r }, h);
+                }
+            }
+        }
+        sink1->evaluated += count;
+    }
+
+    // Finish surviving lanes from tree t with the scalar evaluator:
+    void finishLanes(const int* offsets, float* scores, int mask, int t, float thr) const
+    {
+        for (int i = 0; i < kLanes; i++)
+        {
+            if (mask & (1 << i))
+            {
+                scores[i] = evaluate(chns + offsets[i], t, scores[i], thr);
+            }
+        }
+    }
+
+    static int countLanes(int mask)
+    {
+        int count = 0;
+        for (; mask; mask &= (mask - 1))
+        {
+            count++;
+        }
+        return count;
+    }
+
+#if ACF_DETECT_AVX2
+    ACF_TARGET_AVX2 void evaluateLanes(const int* offsets, float* scores, float cutoff) const
+    {
+        const __m256i off = _mm256_load_si256(reinterpret_cast<const __m256i*>(offsets));
+        const __m256i two = _mm256_set1_epi32(2);
+        const __m256 thr = _mm256_set1_ps(cutoff);
+        __m256 active = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        __m256 h = _mm256_setzero_ps();
+
+        int mask = (1 << kLanes) - 1, t = 0;
+        const CompiledNode* tree = trees;
+        for (; t < nTrees; t++, tree += nodeStride)
+        {
+            const auto* fields = reinterpret_cast<const int*>(tree);
+            const auto* values = reinterpret_cast<const float*>(tree);
+
+            // root (shared by all lanes): k = (ftr < thr) ? 1 : 2
+            __m256 ftr = _mm256_i32gather_ps(chns + tree[0].cid, off, 4);
+            __m256i lt = _mm256_castps_si256(_mm256_cmp_ps(ftr, _mm256_set1_ps(tree[0].thr), _CMP_LT_OQ));
+            __m256i k = _mm256_add_epi32(two, lt);
+
+            // second level: k = (k * 2) + ((ftr < thr) ? 1 : 2)
+            __m256i index = _mm256_slli_epi32(k, 2); // 4 fields per node
+            __m256i cid = _mm256_i32gather_epi32(fields, index, 4);
+            __m256 thr1 = _mm256_i32gather_ps(values + 1, index, 4);
+            ftr = _mm256_i32gather_ps(chns, _mm256_add_epi32(off, cid), 4);
+            lt = _mm256_castps_si256(_mm256_cmp_ps(ftr, thr1, _CMP_LT_OQ));
+            k = _mm256_add_epi32(_mm256_add_epi32(k, k), _mm256_add_epi32(two, lt));
+
+            // leaf
+            __m256 hs = _mm256_i32gather_ps(values + 2, _mm256_slli_epi32(k, 2), 4);
+            h = _mm256_blendv_ps(h, _mm256_add_ps(h, hs), active);
+            active = _mm256_and_ps(active, _mm256_cmp_ps(h, thr, _CMP_GT_OQ));
+
+            mask = _mm256_movemask_ps(active);
+            if (countLanes(mask) < kMinLanes)
+            {
+                t++;
+                break;
+            }
+        }
+
+        _mm256_store_ps(scores, h);
+        finishLanes(offsets, scores, (t < nTrees) ? mask : 0, t, cutoff);
+    }
+#else
+    static float32x4_t gather(const float* ptr, const int32x4_t& index)
+    {
+        float32x4_t v = vdupq_n_f32(0.f);
+        v = vld1q_lane_f32(ptr + vgetq_lane_s32(index, 0), v, 0);
+        v = vld1q_lane_f32(ptr + vgetq_lane_s32(index, 1), v, 1);
+        v = vld1q_lane_f32(ptr + vgetq_lane_s32(index, 2), v, 2);
+        v = vld1q_lane_f32(ptr + vgetq_lane_s32(index, 3), v, 3);
+        return v;
+    }
+
+    static int32x4_t gather(const int* ptr, const int32x4_t& index)
+    {
+        int32x4_t v = vdupq_n_s32(0);
+        v = vld1q_lane_s32(ptr + vgetq_lane_s32(index, 0), v, 0);
+        v = vld1q_lane_s32(ptr + vgetq_lane_s32(index, 1), v, 1);
+        v = vld1q_lane_s32(ptr + vgetq_lane_s32(index, 2), v, 2);
+        v = vld1q_lane_s32(ptr + vgetq_lane_s32(index, 3), v, 3);
+        return v;
+    }
+
+    static int getMask(const uint32x4_t& active)
+    {
+        return (vgetq_lane_u32(active, 0) & 1) | ((vgetq_lane_u32(active, 1) & 1) << 1) | ((vgetq_lane_u32(active, 2) & 1) << 2) | ((vgetq_lane_u32(active, 3) & 1) << 3);
+    }
+
+    void evaluateLanes(const int* offsets, float* scores, float cutoff) const
+    {
+        const int32x4_t off = vld1q_s32(offsets);
+        const int32x4_t two = vdupq_n_s32(2);
+        const float32x4_t thr = vdupq_n_f32(cutoff);
+        uint32x4_t active = vdupq_n_u32(0xffffffff);
+        float32x4_t h = vdupq_n_f32(0.f);
+
+        int mask = (1 << kLanes) - 1, t = 0;
+        const CompiledNode* tree = trees;
+        for (; t < nTrees; t++, tree += nodeStride)
+        {
+            const auto* fields = reinterpret_cast<const int*>(tree);
+            const auto* values = reinterpret_cast<const float*>(tree);
+
+            // root (shared by all lanes): k = (ftr < thr) ? 1 : 2
+            float32x4_t ftr = gather(chns + tree[0].cid, off);
+            int32x4_t lt = vreinterpretq_s32_u32(vcltq_f32(ftr, vdupq_n_f32(tree[0].thr)));
+            int32x4_t k = vaddq_s32(two, lt);
+
+            // second level: k = (k * 2) + ((ftr < thr) ? 1 : 2)
+            int32x4_t index = vshlq_n_s32(k, 2); // 4 fields per node
+            int32x4_t cid = gather(fields, index);
+            float32x4_t thr1 = gather(values + 1, index);
+            ftr = gather(chns, vaddq_s32(off, cid));
+            lt = vreinterpretq_s32_u32(vcltq_f32(ftr, thr1));
+            k = vaddq_s32(vaddq_s32(k, k), vaddq_s32(two, lt));
+
+            // leaf
+            float32x4_t hs = gather(values + 2, vshlq_n_s32(k, 2));
+            h = vbslq_f32(active, vaddq_f32(h, hs), h);
+            active = vandq_u32(active, vcgtq_f32(h, thr));
+
+            mask = getMask(active);
+            if (countLanes(mask) < kMinLanes)
+            {
+                t++;
+                break;
+            }
+        }
+
+        vst1q_f32(scores, h);
+        finishLanes(offsets, scores, (t < nTrees) ? mask : 0, t, cutoff);
+    }
+#endif
+};
+
+#endif // ACF_DETECT_AVX2 || ACF_DETECT_NEON
+
 const cv::Mat& Detector::Classifier::getScaledThresholds(int type) const
 {
     switch (type)
@@ -172,61 +652,192 @@ const cv::Mat& Detector::Classifier::getScaledThresholds(int type) const
         case CV_8UC1:
             CV_Assert(!thrsU8.empty() && (thrsU8.type() == CV_8UC1));
             return thrsU8;
+        case CV_16FC1: // widened to float (see half)
         case CV_32FC1:
             CV_Assert(!thrs.empty() && (thrs.type() == CV_32FC1));
             return thrs;
         default:
-            CV_Assert(type == CV_32FC1 || type == CV_8UC1);
+            CV_Assert(type == CV_32FC1 || type == CV_16FC1 || type == CV_8UC1);
     }
     return thrs; // unused: for static analyzer
 }
 
+void Detector::Classifier::compile()
+{
+    nodes.release();
+    nodesU8.release();
+    if (fids.empty())
+    {
+        return;
+    }
+
+    const int nTrees = fids.rows;
+    const int nTreeNodes = fids.cols;
+    const int nodeStride = ((nTreeNodes + kNodesPerCacheLine - 1) / kNodesPerCacheLine) * kNodesPerCacheLine;
+
+    auto compileWith = [&](const cv::Mat& thresholds, cv::Mat& table) {
+        table = cv::Mat::zeros(nTrees, nodeStride, CV_32SC4);
+        for (int t = 0; t < nTrees; t++)
+        {
+            auto* tree = table.ptr<CompiledNode>(t);
+            for (int k = 0; k < nTreeNodes; k++)
+            {
+                tree[k].cid = fids.at<uint32_t>(t, k);
+                tree[k].thr = (thresholds.depth() == CV_8U) ? float(thresholds.at<uint8_t>(t, k)) : thresholds.at<float>(t, k);
+                tree[k].hs = hs.at<float>(t, k);
+                tree[k].child = child.at<uint32_t>(t, k);
+            }
+        }
+    };
+
+    compileWith(thrs, nodes);
+    if (!thrsU8.empty())
+    {
+        compileWith(thrsU8, nodesU8);
+    }
+}
+
+const cv::Mat& Detector::Classifier::getCompiledNodes(int type) const
+{
+    switch (type)
+    {
+        case CV_8UC1:
+            CV_Assert(!nodesU8.empty());
+            return nodesU8;
+        case CV_16FC1: // widened to float (see half)
+        case CV_32FC1:
+            CV_Assert(!nodes.empty());
+            return nodes;
+        default:
+            CV_Assert(type == CV_32FC1 || type == CV_16FC1 || type == CV_8UC1);
+    }
+    return nodes; // unused: for static analyzer
+}
+
 template <int kDepth>
-std::shared_ptr<DetectionParams> allocDetector(const MatP& I, const cv::Mat& thrs, DetectionSink* sink)
+std::shared_ptr<DetectionParams> allocDetector(const MatP& I, DetectionSink* sink)
 {
     switch (I.depth())
     {
         case CV_8UC1:
-            CV_Assert(thrs.type() == CV_8UC1);
-            return std::make_shared<ParallelDetectionBody<uint8_t, kDepth>>(I[0].ptr<uint8_t>(), thrs.ptr<uint8_t>(), sink);
+            return std::make_shared<ParallelDetectionBody<uint8_t, kDepth>>(I[0].ptr<uint8_t>(), sink);
+#if ACF_DO_HALF
+        case CV_16FC1:
+            return std::make_shared<ParallelDetectionBody<half, kDepth>>(I[0].ptr<half>(), sink);
+#endif
         case CV_32FC1:
-            CV_Assert(thrs.type() == CV_32FC1);
-            return std::make_shared<ParallelDetectionBody<float, kDepth>>(I[0].ptr<float>(), thrs.ptr<float>(), sink);
+            return std::make_shared<ParallelDetectionBody<float, kDepth>>(I[0].ptr<float>(), sink);
         default:
             CV_Assert(I.depth() == CV_8UC1 || I.depth() == CV_32FC1);
     }
     return nullptr; // unused: for static analyzer
 }
 
-std::shared_ptr<DetectionParams> allocDetector(const MatP& I, const cv::Mat& thrs, DetectionSink* sink, int depth)
+std::shared_ptr<DetectionParams> allocDetector(const MatP& I, DetectionSink* sink, int depth)
 {
     // Enforce compile time constants in inner tree search:
     switch (depth)
     {
         case 0:
-            return allocDetector<0>(I, thrs, sink);
+            return allocDetector<0>(I, sink);
         case 1:
-            return allocDetector<1>(I, thrs, sink);
+            return allocDetector<1>(I, sink);
         case 2:
-            return allocDetector<2>(I, thrs, sink);
+#if ACF_DETECT_AVX2 || ACF_DETECT_NEON
+            // Runtime dispatch to the vectorized evaluator for the common depth 2 float case:
+            if ((I.depth() == CV_32F) && ParallelDetectionBodySIMD::isSupported())
+            {
+                return std::make_shared<ParallelDetectionBodySIMD>(I[0].ptr<float>(), sink);
+            }
+#endif
+            return allocDetector<2>(I, sink);
         case 3:
-            return allocDetector<3>(I, thrs, sink);
+            return allocDetector<3>(I, sink);
         case 4:
-            return allocDetector<4>(I, thrs, sink);
+            return allocDetector<4>(I, sink);
         case 5:
-            return allocDetector<5>(I, thrs, sink);
+            return allocDetector<5>(I, sink);
         case 6:
-            return allocDetector<6>(I, thrs, sink);
+            return allocDetector<6>(I, sink);
         case 7:
-            return allocDetector<7>(I, thrs, sink);
+            return allocDetector<7>(I, sink);
         case 8:
-            return allocDetector<8>(I, thrs, sink);
+            return allocDetector<8>(I, sink);
         default:
             CV_Assert(depth <= 8);
     }
     return nullptr;
 }
 
+// Copy the compiled model and replace feature indices with channel offsets for this level:
+static cv::Mat resolveNodes(const cv::Mat& model, const UInt32Vec& cids, int nTreeNodes)
+{
+    cv::Mat nodes(model.size(), model.type());
+    for (int t = 0; t < model.rows; t++)
+    {
+        const auto* src = model.ptr<CompiledNode>(t);
+        auto* dst = nodes.ptr<CompiledNode>(t);
+        for (int k = 0; k < model.cols; k++)
+        {
+            dst[k] = src[k];
+            dst[k].cid = (k < nTreeNodes) ? cids[src[k].cid] : 0;
+        }
+    }
+    return nodes;
+}
+
+// Channel offsets (cids) and the compiled trees resolved against them depend only on the
+// channel geometry, which is fixed for a given input resolution, so they are shared across
+// frames.  Resolved tables are tagged with the compiled model they were built from (the
+// entry holds a reference, so the address can't be recycled) and rebuilt if it changes.
+class ChannelIndexCache
+{
+public:
+    using Key = std::array<int, 10>;
+
+    struct Entry
+    {
+        UInt32Vec cids;
+        cv::Mat model; // compiled trees (feature indices)
+        cv::Mat nodes; // compiled trees (channel offsets)
+    };
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    template <typename Create>
+    EntryPtr get(const Key& key, const cv::Mat& model, Create create)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto iter = m_entries.find(key);
+            if ((iter != m_entries.end()) && (iter->second->model.data == model.data))
+            {
+                return iter->second;
+            }
+        }
+
+        EntryPtr entry = create(); // build outside the lock
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_entries.size() >= kMaxEntries)
+        {
+            m_entries.clear(); // resolution changes are rare: just start over
+        }
+        m_entries[key] = entry;
+        return entry;
+    }
+
+protected:
+    static const std::size_t kMaxEntries = 256;
+
+    std::mutex m_mutex;
+    std::map<Key, EntryPtr> m_entries;
+};
+
+std::shared_ptr<ChannelIndexCache> Detector::createChannelIndexCache()
+{
+    return std::make_shared<ChannelIndexCache>();
+}
+
 // clang-format off
 auto Detector::createDetector
 (
@@ -258,28 +869,35 @@ auto Detector::createDetector
     const auto height1 = static_cast<int>(ceil(float(height * shrink - modelHt + 1) / stride));
     const auto width1 = static_cast<int>(ceil(float(width * shrink - modelWd + 1) / stride));
 
-    // Precompute channel offsets:
-    std::vector<uint32_t> cids;
-    if (rois.size())
-    {
-        cids = computeChannelIndex(rois, rowStride, modelWd / shrink, modelHt / shrink, width, height);
-    }
-    else
-    {
-        cids = computeChannelIndexColMajor(nChns, modelWd / shrink, modelHt / shrink, width, height);
-    }
-
     // Extract relevant fields from trees
     // Note: Need tranpose for column-major storage
     auto& trees = clf;
     int nTreeNodes = trees.fids.rows;
     int nTrees = trees.fids.cols;
     std::swap(nTrees, nTreeNodes);
-    cv::Mat thresholds = trees.getScaledThresholds(I.depth());
+    const cv::Mat& model = trees.getCompiledNodes(I.depth());
 
-    CV_Assert(!thresholds.empty());
+    CV_Assert(model.rows == nTrees && model.cols >= nTreeNodes);
     CV_Assert(trees.treeDepth <= 8);
-    std::shared_ptr<DetectionParams> detector = allocDetector(I, thresholds, sink, trees.treeDepth);
+    std::shared_ptr<DetectionParams> detector = allocDetector(I, sink, trees.treeDepth);
+
+    // Precompute channel offsets and resolve the trees against them (cached):
+    const int chnStride = (rois.size() > 1) ? (rois[1].x - rois[0].x) : 0;
+    const ChannelIndexCache::Key key{ { int(rois.size()), chnStride, nChns, rowStride, width, height, modelWd, modelHt, shrink, I.depth() } };
+    auto entry = m_channelIndexCache->get(key, model, [&]() {
+        auto created = std::make_shared<ChannelIndexCache::Entry>();
+        if (rois.size())
+        {
+            created->cids = computeChannelIndex(rois, rowStride, modelWd / shrink, modelHt / shrink, width, height);
+        }
+        else
+        {
+            created->cids = computeChannelIndexColMajor(nChns, modelWd / shrink, modelHt / shrink, width, height);
+        }
+        created->model = model;
+        created->nodes = resolveNodes(model, created->cids, nTreeNodes);
+        return created;
+    });
 
     // Scanning parameters
     detector->winSize = { modelWd, modelHt };
@@ -288,19 +906,54 @@ auto Detector::createDetector
     detector->stride = stride;
     detector->shrink = shrink;
     detector->rowStride = rowStride;
-    detector->cids = cids;
+    detector->tiles = computeTiles(detector->size1, detector->winSize, stride, shrink, nChns, int(I[0].elemSize()));
 
     // Tree parameters:
-    detector->fids = trees.fids.ptr<uint32_t>();
     detector->nTrees = nTrees;
     detector->nTreeNodes = nTreeNodes;
-    detector->hs = trees.hs.ptr<float>();
-    detector->child = trees.child.ptr<uint32_t>();
+    detector->nodes = entry->nodes; // shared, read only
+    detector->trees = detector->nodes.ptr<CompiledNode>();
+    detector->nodeStride = detector->nodes.cols;
     detector->I = I;
 
     return detector;
 }
 
+static void appendDetections(const DetectionParams& detector, const DetectionSinkVec& sinks, Detector::DetectionVec& objects)
+{
+    for (const auto& sink : sinks)
+    {
+        for (const auto& hit : sink.hits)
+        {
+            cv::Rect roi({ hit.first.x * detector.stride, hit.first.y * detector.stride }, detector.winSize);
+#if GPU_ACF_TRANSPOSE
+            std::swap(roi.x, roi.y);
+            std::swap(roi.width, roi.height);
+#endif
+            objects.emplace_back(roi, hit.second);
+        }
+    }
+}
+
+static std::size_t countWindows(const DetectionSinkVec& sinks)
+{
+    std::size_t count = 0;
+    for (const auto& sink : sinks)
+    {
+        count += sink.evaluated;
+    }
+    return count;
+}
+
+void Detector::initCoarseToFine(DetectionParams& detector) const
+{
+    if (m_doCoarseToFine)
+    {
+        detector.coarseStep = 2;
+        detector.coarseMargin = static_cast<float>(m_coarseToFineMargin);
+    }
+}
+
 // Changelog:
 //
 // 3/21/2015: Rework arithmetic for row-major storage order
@@ -318,20 +971,131 @@ void Detector::acfDetect1
 )
 // clang-format on
 {
-    DetectionSink detections;
-    auto detector = createDetector(I, rois, shrink, modelDsPad, stride, &detections);
+    auto detector = createDetector(I, rois, shrink, modelDsPad, stride, nullptr);
     detector->cascThr = cascThr;
-    (*detector)({ 0, detector->size1.width });
+    initCoarseToFine(*detector);
 
-    for (const auto& hit : detections.hits)
+    DetectionBound bound(m_maxCandidateCount, m_candidateMargin);
+    DetectionSinkVec sinks(detector->tiles.size());
+    bound.init(sinks);
+    detector->sinks = sinks.data();
+
+    const cv::Range range(0, static_cast<int>(detector->tiles.size()));
+    if (m_doParallel)
     {
-        cv::Rect roi({ hit.first.x * stride, hit.first.y * stride }, detector->winSize);
-#if GPU_ACF_TRANSPOSE
-        std::swap(roi.x, roi.y);
-        std::swap(roi.width, roi.height);
-#endif
-        objects.emplace_back(roi, hit.second);
+        cv::parallel_for_(range, *detector);
+    }
+    else
+    {
+        (*detector)(range);
+    }
+
+    m_windowCount += countWindows(sinks);
+
+    std::vector<DetectionVec> objects1(1);
+    appendDetections(*detector, sinks, objects1[0]);
+    bound.prune(objects1);
+    std::copy(objects1[0].begin(), objects1[0].end(), std::back_inserter(objects));
+}
+
+// Scan all pyramid levels with a single flattened list of (level, tile) jobs.  Nested
+// cv::parallel_for_ calls run serially, so a per level parallel scan would leave cores
+// idle on the large levels, while a per level job would leave them idle on the small ones.
+// clang-format off
+void Detector::acfDetectPyramid
+(
+    const Pyramid& P,
+    int shrink,
+    const cv::Size& modelDsPad,
+    int stride,
+    double cascThr,
+    std::vector<DetectionVec>& objects,
+    const RectVec* windows
+)
+// clang-format on
+{
+    std::vector<DetectionParamPtr> detectors(P.nScales);
+    std::vector<DetectionSinkVec> sinks(P.nScales);
+    DetectionBound bound(m_maxCandidateCount, m_candidateMargin);
+    std::vector<cv::Point> jobs; // { level, tile }
+
+    for (int i = 0; i < P.nScales; i++)
+    {
+        if (P.data[i].empty() || (windows && (*windows)[i].empty()))
+        {
+            continue; // not populated (see PyramidSink) or nothing to scan
+        }
+
+        // ROI fields indicates row major storage, else column major:
+        const RectVec rois = (P.rois.size() > i) ? P.rois[i] : RectVec();
+
+        detectors[i] = createDetector(P.data[i][0], rois, shrink, modelDsPad, stride, nullptr);
+        detectors[i]->cascThr = cascThr;
+        initCoarseToFine(*detectors[i]);
+        if (windows)
+        {
+            // Restrict the scan tiles to the requested windows:
+            auto& tiles = detectors[i]->tiles;
+            for (auto& tile : tiles)
+            {
+                tile &= (*windows)[i];
+            }
+            tiles.erase(std::remove_if(tiles.begin(), tiles.end(), [](const cv::Rect& tile) { return tile.empty(); }), tiles.end());
+        }
+        sinks[i].resize(detectors[i]->tiles.size());
+        bound.init(sinks[i]);
+        detectors[i]->sinks = sinks[i].data();
+
+        for (int t = 0; t < detectors[i]->tiles.size(); t++)
+        {
+            jobs.emplace_back(i, t);
+        }
+    }
+
+    // Cost is the number of windows in the tile times the cascade length:
+    std::vector<double> costs(jobs.size());
+    for (int j = 0; j < jobs.size(); j++)
+    {
+        const auto& detector = *detectors[jobs[j].x];
+        costs[j] = double(detector.tiles[jobs[j].y].area()) * double(detector.nTrees);
+    }
+
+    // Tiles that start after the deadline are skipped (see setTimeBudget()):
+    std::vector<uint8_t> skipped(jobs.size(), 0);
+    TaskScheduler scheduler("scan");
+    scheduler.run(costs, [&](int j) {
+        const auto& job = jobs[j];
+        if (isPastDeadline())
+        {
+            skipped[j] = 1;
+            return;
+        }
+        (*detectors[job.x])({ job.y, job.y + 1 });
+    }, m_doParallel);
+    const auto& timings = scheduler.timings();
+    std::copy(timings.begin(), timings.end(), std::back_inserter(m_detectionTimings));
+
+    std::vector<bool> isPartial(P.nScales, false);
+    for (int j = 0; j < jobs.size(); j++)
+    {
+        isPartial[jobs[j].x] = isPartial[jobs[j].x] || skipped[j];
     }
+
+    objects.resize(P.nScales);
+    for (int i = 0; i < P.nScales; i++)
+    {
+        if (isPartial[i])
+        {
+            m_skippedScales.push_back(P.scales[i]);
+        }
+
+        if (detectors[i])
+        {
+            appendDetections(*detectors[i], sinks[i], objects[i]);
+            m_windowCount += countWindows(sinks[i]);
+        }
+    }
+    bound.prune(objects);
 }
 
 float Detector::evaluate(const MatP& I, int shrink, const cv::Size& modelDsPad, int stride) const
@@ -343,6 +1107,33 @@ float Detector::evaluate(const MatP& I, int shrink, const cv::Size& modelDsPad,
 
 // local static utility routines:
 
+static RectVec computeTiles(const cv::Size& size1, const cv::Size& winSize, int stride, int shrink, int nChns, int elemSize)
+{
+    const int kTileBytes = 128 * 1024; // half of a typical L2
+    const int kTileMin = 8, kTileMax = 64;
+
+    int n = kTileMax;
+    for (; n > kTileMin; n /= 2)
+    {
+        const int wd = (n * stride + winSize.width) / shrink;
+        const int ht = (n * stride + winSize.height) / shrink;
+        if ((wd * ht * nChns * elemSize) <= kTileBytes)
+        {
+            break;
+        }
+    }
+
+    RectVec tiles;
+    for (int c = 0; c < size1.width; c += n)
+    {
+        for (int r = 0; r < size1.height; r += n)
+        {
+            tiles.emplace_back(c, r, std::min(n, size1.width - c), std::min(n, size1.height - r));
+        }
+    }
+    return tiles;
+}
+
 static UInt32Vec computeChannelIndex(const RectVec& rois, uint32 rowStride, int modelWd, int modelHt, int width, int height)
 {
 #if GPU_ACF_TRANSPOSE
@@ -0,0 +1,297 @@
+/*! -*-c++-*-
+  @file   chnsFused.cpp
+  @author David Hirvonen
+  @brief  Band tiled computation of the default color, gradient magnitude and histogram channels.
+
+  \copyright Copyright 2018 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Toolbox images are column major, so a band is a run of whole columns (image rows in the
+  cv::Mat view).  Each band is smoothed, differentiated, normalized, binned and shrunk before
+  the next one is started, and only the shrunk channels are written to the output.  The
+  streaming filters carry their column state from band to band and every stage runs the same
+  per column code as the full frame toolbox passes, so the result is bit-exact with them.
+
+*/
+
+#include <acf/toolbox/wrappers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Declarations:
+void convTriY(float* I, float* O, int h, int r, int s);
+void convTri1Y(float* I, float* O, int h, float p, int s);
+void convTriInit(float* I, float* T, float* U, int h, int h0, int r, float nrm);
+void convTriStep(float* Il, float* Im, float* Ir, float* T, float* U, int h, int h0, float nrm);
+void convTri1Step(float* Il, float* Im, float* Ir, float* T, int h, int h0, float nrm, float p);
+void gradMagColumn(float* I, float* M, float* O, float* Gx, float* Gy, float* M2, int h, int w, int d, int x, bool full);
+void gradMagNormColumn(float* M, float* S, int h, int w, int x, float norm);
+bool gradHistColumn(float* M, float* O, float* H, int* O0, int* O1, float* M0, float* M1, int h, int w, int bin, int nOrients, int softBin, bool full, int x, float& xb);
+void gradHistNormalize(float* H, int h, int w, int bin, int nOrients, int softBin);
+void imResample(float* A, float* B, int ha, int hb, int wa, int wb, int d, float nrm);
+
+namespace
+{
+
+// Contiguous columns [first, first + count) of an image with h rows, holding at most size
+// columns at a time.  The columns slide back to the start of a buffer twice that size only
+// when it runs out, so discarding is free and copying is amortized over many columns.  The
+// buffer is scratch memory of the enclosing ScratchScope.
+class ColumnWindow
+{
+public:
+    ColumnWindow(int h, int size)
+        : h(h)
+        , capacity(2 * size)
+        , data(reinterpret_cast<float*>(alScratch(capacity * h * sizeof(float), 16)))
+    {
+    }
+
+    ColumnWindow(const ColumnWindow& src) = delete;
+    ColumnWindow& operator=(const ColumnWindow& src) = delete;
+
+    float* col(int x)
+    {
+        return data + (offset + x - first) * h;
+    }
+
+    // add column first + count and return it
+    float* append()
+    {
+        if (offset + count == capacity)
+        {
+            memmove(data, data + offset * h, count * h * sizeof(float));
+            offset = 0;
+        }
+        count++;
+        return col(first + count - 1);
+    }
+
+    // drop the columns before x
+    void discard(int x)
+    {
+        const int n = std::max(0, std::min(x - first, count));
+        offset += n;
+        first += n;
+        count -= n;
+    }
+
+protected:
+    int h;
+    int capacity;
+    int first = 0;
+    int count = 0;
+    int offset = 0;
+    float* data;
+};
+
+// Detector::convTri(I, J, r, 1) one output column at a time, outside of its nomex regime.
+// Column i must be requested in order and needs input columns i - back() .. i + ahead().
+// The filter state is scratch memory of the enclosing ScratchScope.
+class ConvTriStream
+{
+public:
+    ConvTriStream(int h, int w, double r)
+        : h(h)
+        , w(w)
+        , h0(h - (h % 4))
+    {
+        if (r > 0 && r <= 1.0)
+        {
+            mode = kTri1;
+            p = float(12.0 / r / (r + 2.0) - 2.0);
+            nrm = 1.0f / ((p + 2) * (p + 2));
+            T = reinterpret_cast<float*>(alScratch(h * sizeof(float), 16));
+        }
+        else if (r > 0)
+        {
+            mode = kTri;
+            ri = static_cast<int>(std::round(static_cast<float>(r)));
+            const int r1 = ri + 1;
+            nrm = 1.0f / (r1 * r1 * r1 * r1);
+            T = reinterpret_cast<float*>(alScratch(2 * (h0 + 4) * sizeof(float), 16));
+        }
+    }
+
+    int ahead() const
+    {
+        return (mode == kTri) ? ri : (mode == kTri1);
+    }
+
+    int back() const
+    {
+        return (mode == kTri) ? (ri + 2) : (mode == kTri1);
+    }
+
+    // compute output column i into O, where col(j) returns input column j
+    template <typename Col>
+    void column(int i, const Col& col, float* O)
+    {
+        switch (mode)
+        {
+            case kNone:
+                memcpy(O, col(i), h * sizeof(float));
+                break;
+            case kTri1:
+                convTri1Step(col(std::max(i - 1, 0)), col(i), col(std::min(i + 1, w - 1)), T, h, h0, nrm, p);
+                convTri1Y(T, O, h, p, 1);
+                break;
+            case kTri:
+            {
+                const int r1 = ri + 1;
+                float *t = T, *u = t + (h0 + 4);
+                if (i == 0)
+                {
+                    convTriInit(col(0), t, u, h, h0, r1, nrm);
+                }
+                else
+                {
+                    float* Il = col((i <= r1) ? (r1 - i) : (i - 1 - r1));
+                    float* Ir = col((i > w - r1) ? (2 * w - r1 - i) : (i - 1 + r1));
+                    convTriStep(Il, col(i - 1), Ir, t, u, h, h0, nrm);
+                }
+                convTriY(u, O, h, ri, 1);
+                break;
+            }
+        }
+    }
+
+protected:
+    enum Mode
+    {
+        kNone,
+        kTri1,
+        kTri
+    };
+
+    Mode mode = kNone;
+    int h, w, h0, ri = 0;
+    float p = 0.f, nrm = 1.f;
+    float* T = nullptr;
+};
+
+} // namespace
+
+// Compute the color (C), normalized gradient magnitude (M) and gradient histogram (H)
+// channels of the [h x w x d] image I shrunk by shrink, as chnsCompute() does with
+// binSize == shrink.  Column bands of band columns (a multiple of shrink, or 0 to size them
+// for the L2 cache) flow through all stages.  Requires shrink <= 4, so the band resampling
+// matches the full frame one, and filter radii outside of the convTri() nomex regime.
+void chnsFused(float* I, float* C, float* M, float* H, int h, int w, int d, int shrink, double smooth, int colorChn, int normRad, float normConst, bool full, int nOrients, int softBin, int band)
+{
+    const int hs = h / shrink, ws = w / shrink, h4 = (h % 4 == 0) ? h : h - (h % 4) + 4;
+    if (band <= 0)
+    {
+        band = static_cast<int>((512 * 1024) / (h * sizeof(float) * (d + 3)));
+    }
+    band = std::max(4 * shrink, (band / shrink) * shrink);
+
+    ScratchScope scratch;
+    std::vector<ConvTriStream> smoothers;
+    smoothers.reserve(d);
+    for (int z = 0; z < d; z++)
+    {
+        smoothers.emplace_back(h, w, smooth);
+    }
+    ConvTriStream normalizer(h, w, normRad);
+    const int ahead = normRad ? normalizer.ahead() : 0, back = normRad ? normalizer.back() : 0;
+
+    // column windows, sized for what they keep from band to band (see below)
+    const int size = band + ahead + back + 2;
+    std::vector<std::unique_ptr<ColumnWindow>> Is(d);
+    for (auto& window : Is)
+    {
+        window.reset(new ColumnWindow(h, size));
+    }
+    ColumnWindow Mw(h, size), Ow(h, size);
+    auto* Mn = reinterpret_cast<float*>(alScratch(band * h * sizeof(float), 16));
+    auto* S = reinterpret_cast<float*>(alScratch(h * sizeof(float), 16));
+
+    auto* Gx = reinterpret_cast<float*>(alScratch(h4 * sizeof(float), 16));
+    auto* Gy = reinterpret_cast<float*>(alScratch(h4 * sizeof(float), 16));
+    auto* M2 = reinterpret_cast<float*>(alScratch(h4 * sizeof(float), 16));
+    auto* O0 = reinterpret_cast<int*>(alScratch(h * sizeof(int), 16));
+    auto* O1 = reinterpret_cast<int*>(alScratch(h * sizeof(int), 16));
+    auto* M0 = reinterpret_cast<float*>(alScratch(h * sizeof(float), 16));
+    auto* M1 = reinterpret_cast<float*>(alScratch(h * sizeof(float), 16));
+
+    memset(H, 0, nOrients * hs * ws * sizeof(float));
+    int isEnd = 0, mEnd = 0;
+    bool hist = true;
+    float xb = 0.f;
+    for (int b0 = 0, b1; b0 < w; b0 = b1)
+    {
+        b1 = std::min(w, b0 + band);
+        const int needM = std::min(w, b1 + ahead), needIs = std::min(w, needM + 1);
+
+        // smoothed color columns, one past the last gradient column for the central differences
+        for (; isEnd < needIs; isEnd++)
+        {
+            for (int z = 0; z < d; z++)
+            {
+                float* Iz = I + z * h * w;
+                smoothers[z].column(isEnd, [&](int j) { return Iz + j * h; }, Is[z]->append());
+            }
+        }
+
+        // gradient magnitude and orientation, up to the normalization filter support
+        for (; mEnd < needM; mEnd++)
+        {
+            gradMagColumn(Is[colorChn]->col(mEnd), Mw.append(), Ow.append(), Gx, Gy, M2, h, w, 1, mEnd, full);
+        }
+
+        // normalized magnitude and histograms for the band
+        for (int x = b0; x < b1; x++)
+        {
+            float* Mx = Mn + (x - b0) * h;
+            memcpy(Mx, Mw.col(x), h * sizeof(float));
+            if (normRad != 0)
+            {
+                normalizer.column(x, [&](int j) { return Mw.col(j); }, S);
+                gradMagNormColumn(Mx, S, h, w, x, normConst);
+            }
+            if (hist)
+            {
+                hist = gradHistColumn(Mx, Ow.col(x), H, O0, O1, M0, M1, h, w, shrink, nOrients, softBin, full, x, xb);
+            }
+        }
+
+        // shrink the band into the output channels
+        const int s0 = (b0 / shrink) * hs, n = b1 - b0;
+        for (int z = 0; z < d; z++)
+        {
+            float* Cz = C + z * hs * ws + s0;
+            if (shrink == 1)
+            {
+                memcpy(Cz, Is[z]->col(b0), n * h * sizeof(float));
+            }
+            else
+            {
+                imResample(Is[z]->col(b0), Cz, h, hs, n, n / shrink, 1, 1.0f);
+            }
+        }
+        if (shrink == 1)
+        {
+            memcpy(M + s0, Mn, n * h * sizeof(float));
+        }
+        else
+        {
+            imResample(Mn, M + s0, h, hs, n, n / shrink, 1, 1.0f);
+        }
+
+        // keep the color columns still to be differentiated, the magnitude columns in the
+        // support of the normalization filter and the orientation columns not yet binned
+        for (auto& window : Is)
+        {
+            window->discard(std::min(b1, needM - 1));
+        }
+        Mw.discard(b1 - back);
+        Ow.discard(b1);
+    }
+
+    gradHistNormalize(H, h, w, shrink, nOrients, softBin);
+}
@@ -81,93 +81,6 @@ void convBoxY(float* I, float* O, int h, int r, int s)
     }
 }
 
-// convolve I by a 2r+1 x 2r+1 ones filter (uses SSE)
-void convBox(float* I, float* O, int h, int w, int d, int r, int s)
-{
-    float nrm = 1.0f / ((2 * r + 1) * (2 * r + 1));
-    int i, j, k = (s - 1) / 2, h0, h1, w0;
-    if (h % 4 == 0)
-    {
-        h0 = h1 = h;
-    }
-    else
-    {
-        h0 = h - (h % 4);
-        h1 = h0 + 4;
-    }
-    w0 = (w / s) * s;
-    auto* T = reinterpret_cast<float*>(alMalloc(h1 * sizeof(float), 16));
-    while (d-- > 0)
-    {
-        // initialize T
-        memset(T, 0, h1 * sizeof(float));
-        for (i = 0; i <= r; i++)
-        {
-            for (j = 0; j < h0; j += 4)
-            {
-                {
-                    INC(T[j], LDu(I[j + i * h]));
-                }
-            }
-        }
-        for (j = 0; j < h0; j += 4)
-        {
-            STR(T[j], MUL(nrm, SUB(MUL(2, LD(T[j])), LDu(I[j + r * h]))));
-        }
-        for (i = 0; i <= r; i++)
-        {
-            for (j = h0; j < h; j++)
-            {
-                {
-                    T[j] += I[j + i * h];
-                }
-            }
-        }
-        for (j = h0; j < h; j++)
-        {
-            T[j] = nrm * (2 * T[j] - I[j + r * h]);
-        }
-        // prepare and convolve each column in turn
-        k++;
-        if (k == s)
-        {
-            k = 0;
-            convBoxY(T, O, h, r, s);
-            O += h / s;
-        }
-        for (i = 1; i < w0; i++)
-        {
-            float* Il = I + (i - 1 - r) * h;
-            if (i <= r)
-            {
-                Il = I + (r - i) * h;
-            }
-            float* Ir = I + (i + r) * h;
-            if (i >= w - r)
-            {
-                Ir = I + (2 * w - r - i - 1) * h;
-            }
-            for (j = 0; j < h0; j += 4)
-            {
-                DEC(T[j], MUL(nrm, SUB(LDu(Il[j]), LDu(Ir[j]))));
-            }
-            for (j = h0; j < h; j++)
-            {
-                T[j] -= nrm * (Il[j] - Ir[j]);
-            }
-            k++;
-            if (k == s)
-            {
-                k = 0;
-                convBoxY(T, O, h, r, s);
-                O += h / s;
-            }
-        }
-        I += w * h;
-    }
-    alFree(T);
-}
-
 // convolve one column of I by a [1; 1] filter (uses SSE)
 void conv11Y(float* I, float* O, int h, int side, int s)
 {
@@ -230,7 +143,8 @@ void conv11(float* I, float* O, int h, int w, int d, int side, int s)
 {
     const float nrm = 0.25f;
     int i, j;
-    float *I0, *I1, *T = reinterpret_cast<float*>(alMalloc(h * sizeof(float), 16));
+    ScratchScope scratch;
+    float *I0, *I1, *T = reinterpret_cast<float*>(alScratch(h * sizeof(float), 16));
     for (int d0 = 0; d0 < d; d0++)
     {
         for (i = s / 2; i < w; i += s)
@@ -262,7 +176,6 @@ void conv11(float* I, float* O, int h, int w, int d, int side, int s)
             O += h / s;
         }
     }
-    alFree(T);
 }
 
 // convolve one column of I by a 2rx1 triangle filter
@@ -343,104 +256,6 @@ void convTriY(float* I, float* O, int h, int r, int s)
     }
 }
 
-// convolve I by a 2rx1 triangle filter (uses SSE)
-void convTri(float* I, float* O, int h, int w, int d, int r, int s)
-{
-    r++;
-    float nrm = 1.0f / (r * r * r * r);
-    int i, j, k = (s - 1) / 2, h0, h1, w0;
-    if (h % 4 == 0)
-    {
-        h0 = h1 = h;
-    }
-    else
-    {
-        h0 = h - (h % 4);
-        h1 = h0 + 4;
-    }
-    w0 = (w / s) * s;
-    float *T = reinterpret_cast<float*>(alMalloc(2 * h1 * sizeof(float), 16)), *U = T + h1;
-    while (d-- > 0)
-    {
-        // initialize T and U
-        for (j = 0; j < h0; j += 4)
-        {
-            STR(U[j], STR(T[j], LDu(I[j])));
-        }
-        for (i = 1; i < r; i++)
-        {
-            for (j = 0; j < h0; j += 4)
-            {
-                INC(U[j], INC(T[j], LDu(I[j + i * h])));
-            }
-        }
-        for (j = 0; j < h0; j += 4)
-        {
-            STR(U[j], MUL(nrm, (SUB(MUL(2, LD(U[j])), LD(T[j])))));
-        }
-        for (j = 0; j < h0; j += 4)
-        {
-            STR(T[j], 0);
-        }
-        for (j = h0; j < h; j++)
-        {
-            U[j] = T[j] = I[j];
-        }
-        for (i = 1; i < r; i++)
-        {
-            for (j = h0; j < h; j++)
-            {
-                U[j] += T[j] += I[j + i * h];
-            }
-        }
-        for (j = h0; j < h; j++)
-        {
-            U[j] = nrm * (2 * U[j] - T[j]);
-            T[j] = 0;
-        }
-        // prepare and convolve each column in turn
-        k++;
-        if (k == s)
-        {
-            k = 0;
-            convTriY(U, O, h, r - 1, s);
-            O += h / s;
-        }
-        for (i = 1; i < w0; i++)
-        {
-            float* Il = I + (i - 1 - r) * h;
-            if (i <= r)
-            {
-                Il = I + (r - i) * h;
-            }
-            float* Im = I + (i - 1) * h;
-            float* Ir = I + (i - 1 + r) * h;
-            if (i > w - r)
-            {
-                Ir = I + (2 * w - r - i) * h;
-            }
-            for (j = 0; j < h0; j += 4)
-            {
-                INC(T[j], ADD(LDu(Il[j]), LDu(Ir[j]), MUL(-2, LDu(Im[j]))));
-                INC(U[j], MUL(nrm, LD(T[j])));
-            }
-            for (j = h0; j < h; j++)
-            {
-                U[j] += nrm * (T[j] += Il[j] + Ir[j] - 2 * Im[j]);
-            }
-            k++;
-            if (k == s)
-            {
-                k = 0;
-                convTriY(U, O, h, r - 1, s);
-                O += h / s;
-            }
-        }
-        I += w * h;
-    }
-    alFree(T);
-}
-
 // convolve one column of I by a [1 p 1] filter (uses SSE)
 void convTri1Y(float* I, float* O, int h, float p, int s)
 {
@@ -490,38 +305,43 @@ void convTri1Y(float* I, float* O, int h, float p, int s)
 #undef C4
 }
 
-// convolve I by a [1 p 1] filter (uses SSE)
+#define ACF_SIMD_KERNELS <acf/toolbox/convConstKernels.hpp>
+#include <acf/toolbox/simdDispatch.hpp>
+
+// convolve I by a 2r+1 x 2r+1 ones filter (uses SSE/AVX)
+void convBox(float* I, float* O, int h, int w, int d, int r, int s)
+{
+    ACF_SIMD_DISPATCH(convBox, I, O, h, w, d, r, s);
+}
+
+// convolve I by a 2rx1 triangle filter (uses SSE/AVX)
+void convTri(float* I, float* O, int h, int w, int d, int r, int s)
+{
+    ACF_SIMD_DISPATCH(convTri, I, O, h, w, d, r, s);
+}
+
+// convolve I by a [1 p 1] filter (uses SSE/AVX)
 void convTri1(float* I, float* O, int h, int w, int d, float p, int s)
 {
-    const float nrm = 1.0f / ((p + 2) * (p + 2));
-    int i, j, h0 = h - (h % 4);
-    float *Il, *Im, *Ir, *T = reinterpret_cast<float*>(alMalloc(h * sizeof(float), 16));
-    for (int d0 = 0; d0 < d; d0++)
-    {
-        for (i = s / 2; i < w; i += s)
-        {
-            Il = Im = Ir = I + i * h + d0 * h * w;
-            if (i > 0)
-            {
-                Il -= h;
-            }
-            if (i < w - 1)
-            {
-                Ir += h;
-            }
-            for (j = 0; j < h0; j += 4)
-            {
-                STR(T[j], MUL(nrm, ADD(ADD(LDu(Il[j]), MUL(p, LDu(Im[j]))), LDu(Ir[j]))));
-            }
-            for (j = h0; j < h; j++)
-            {
-                T[j] = nrm * (Il[j] + p * Im[j] + Ir[j]);
-            }
-            convTri1Y(T, O, h, p, s);
-            O += h / s;
-        }
-    }
-    alFree(T);
+    ACF_SIMD_DISPATCH(convTri1, I, O, h, w, d, p, s);
+}
+
+// initialize the column sums of convTri() from the first r (incremented) columns of I
+void convTriInit(float* I, float* T, float* U, int h, int h0, int r, float nrm)
+{
+    ACF_SIMD_DISPATCH(convTriInit, I, T, U, h, h0, r, nrm);
+}
+
+// advance the column sums of convTri() by one column
+void convTriStep(float* Il, float* Im, float* Ir, float* T, float* U, int h, int h0, float nrm)
+{
+    ACF_SIMD_DISPATCH(convTriStep, Il, Im, Ir, T, U, h, h0, nrm);
+}
+
+// filter one column of convTri1() along x (see convTri1Y() for the other direction)
+void convTri1Step(float* Il, float* Im, float* Ir, float* T, int h, int h0, float nrm, float p)
+{
+    ACF_SIMD_DISPATCH(convTri1Step, Il, Im, Ir, T, h, h0, nrm, p);
 }
 
 // convolve one column of I by a 2rx1 max filter
@@ -592,7 +412,8 @@ void convMax(float* I, float* O, int h, int w, int d, int r)
         r = h - 1;
     }
     int m = 2 * r + 1;
-    auto* T = reinterpret_cast<float*>(alMalloc(m * 2 * sizeof(float), 16));
+    ScratchScope scratch;
+    auto* T = reinterpret_cast<float*>(alScratch(m * 2 * sizeof(float), 16));
     for (int d0 = 0; d0 < d; d0++)
     {
         for (int x = 0; x < w; x++)
@@ -601,7 +422,6 @@ void convMax(float* I, float* O, int h, int w, int d, int r)
             convMaxY(Ic, Oc, T, h, r);
         }
     }
-    alFree(T);
 }
 
 // B=convConst(type,A,r,s); fast 2D convolutions (see convTri.m and convBox.m)
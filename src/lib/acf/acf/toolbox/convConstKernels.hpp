@@ -0,0 +1,321 @@
+/*! -*-c++-*-
+  @file   convConstKernels.hpp
+  @author David Hirvonen
+  @brief  Width generic X passes of the box and triangle filters in convConst.cpp.
+
+  \copyright Copyright 2018 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  No include guard: compiled once per SIMD backend ACF_SIMD through simdDispatch.hpp.  Each
+  span helper processes [j, n) in steps of V::kWidth and returns the first unprocessed index,
+  so a wide span is followed by a 128 bit span and the original scalar tail, and every column
+  sees the same arithmetic as the 128 bit path.
+
+*/
+
+// T += I
+template <typename V>
+inline int addSpan(float* T, const float* I, int j, int n)
+{
+    for (; j + V::kWidth <= n; j += V::kWidth)
+    {
+        V::store(T + j, V::add(V::load(T + j), V::load(I + j)));
+    }
+    return j;
+}
+
+// T = nrm * (2 * T - I)
+template <typename V>
+inline int boxInitSpan(float* T, const float* I, float nrm, int j, int n)
+{
+    const typename V::F vNrm = V::set(nrm), vTwo = V::set(2);
+    for (; j + V::kWidth <= n; j += V::kWidth)
+    {
+        V::store(T + j, V::mul(vNrm, V::sub(V::mul(vTwo, V::load(T + j)), V::load(I + j))));
+    }
+    return j;
+}
+
+// T -= nrm * (Il - Ir)
+template <typename V>
+inline int boxStepSpan(float* T, const float* Il, const float* Ir, float nrm, int j, int n)
+{
+    const typename V::F vNrm = V::set(nrm);
+    for (; j + V::kWidth <= n; j += V::kWidth)
+    {
+        V::store(T + j, V::sub(V::load(T + j), V::mul(vNrm, V::sub(V::load(Il + j), V::load(Ir + j)))));
+    }
+    return j;
+}
+
+// U = T = I
+template <typename V>
+inline int triCopySpan(float* T, float* U, const float* I, int j, int n)
+{
+    for (; j + V::kWidth <= n; j += V::kWidth)
+    {
+        const typename V::F x = V::load(I + j);
+        V::store(T + j, x);
+        V::store(U + j, x);
+    }
+    return j;
+}
+
+// U += T += I
+template <typename V>
+inline int triAddSpan(float* T, float* U, const float* I, int j, int n)
+{
+    for (; j + V::kWidth <= n; j += V::kWidth)
+    {
+        const typename V::F t = V::add(V::load(T + j), V::load(I + j));
+        V::store(T + j, t);
+        V::store(U + j, V::add(V::load(U + j), t));
+    }
+    return j;
+}
+
+// U = nrm * (2 * U - T), T = 0
+template <typename V>
+inline int triInitSpan(float* T, float* U, float nrm, int j, int n)
+{
+    const typename V::F vNrm = V::set(nrm), vTwo = V::set(2), vZero = V::set(0);
+    for (; j + V::kWidth <= n; j += V::kWidth)
+    {
+        V::store(U + j, V::mul(vNrm, V::sub(V::mul(vTwo, V::load(U + j)), V::load(T + j))));
+        V::store(T + j, vZero);
+    }
+    return j;
+}
+
+// T += Il + Ir - 2 * Im, U += nrm * T
+template <typename V>
+inline int triStepSpan(float* T, float* U, const float* Il, const float* Im, const float* Ir, float nrm, int j, int n)
+{
+    const typename V::F vNrm = V::set(nrm), vMinusTwo = V::set(-2);
+    for (; j + V::kWidth <= n; j += V::kWidth)
+    {
+        const typename V::F d = V::add(V::add(V::load(Il + j), V::load(Ir + j)), V::mul(vMinusTwo, V::load(Im + j)));
+        const typename V::F t = V::add(V::load(T + j), d);
+        V::store(T + j, t);
+        V::store(U + j, V::add(V::load(U + j), V::mul(vNrm, t)));
+    }
+    return j;
+}
+
+// T = nrm * (Il + p * Im + Ir)
+template <typename V>
+inline int tri1Span(float* T, const float* Il, const float* Im, const float* Ir, float nrm, float p, int j, int n)
+{
+    const typename V::F vNrm = V::set(nrm), vP = V::set(p);
+    for (; j + V::kWidth <= n; j += V::kWidth)
+    {
+        V::store(T + j, V::mul(vNrm, V::add(V::add(V::load(Il + j), V::mul(vP, V::load(Im + j))), V::load(Ir + j))));
+    }
+    return j;
+}
+
+// initialize the column sums T and U of convTri() from the first r columns of I (r already
+// incremented), h0 = h - h % 4
+inline void convTriInit(float* I, float* T, float* U, int h, int h0, int r, float nrm)
+{
+    int i, j;
+    triCopySpan<Simd128>(T, U, I, triCopySpan<ACF_SIMD>(T, U, I, 0, h0), h0);
+    for (i = 1; i < r; i++)
+    {
+        triAddSpan<Simd128>(T, U, I + i * h, triAddSpan<ACF_SIMD>(T, U, I + i * h, 0, h0), h0);
+    }
+    triInitSpan<Simd128>(T, U, nrm, triInitSpan<ACF_SIMD>(T, U, nrm, 0, h0), h0);
+    for (j = h0; j < h; j++)
+    {
+        U[j] = T[j] = I[j];
+    }
+    for (i = 1; i < r; i++)
+    {
+        for (j = h0; j < h; j++)
+        {
+            U[j] += T[j] += I[j + i * h];
+        }
+    }
+    for (j = h0; j < h; j++)
+    {
+        U[j] = nrm * (2 * U[j] - T[j]);
+        T[j] = 0;
+    }
+}
+
+// advance the column sums T and U of convTri() by one column
+inline void convTriStep(float* Il, float* Im, float* Ir, float* T, float* U, int h, int h0, float nrm)
+{
+    triStepSpan<Simd128>(T, U, Il, Im, Ir, nrm, triStepSpan<ACF_SIMD>(T, U, Il, Im, Ir, nrm, 0, h0), h0);
+    for (int j = h0; j < h; j++)
+    {
+        U[j] += nrm * (T[j] += Il[j] + Ir[j] - 2 * Im[j]);
+    }
+}
+
+// filter one column of convTri1() along x, h0 = h - h % 4
+inline void convTri1Step(float* Il, float* Im, float* Ir, float* T, int h, int h0, float nrm, float p)
+{
+    tri1Span<Simd128>(T, Il, Im, Ir, nrm, p, tri1Span<ACF_SIMD>(T, Il, Im, Ir, nrm, p, 0, h0), h0);
+    for (int j = h0; j < h; j++)
+    {
+        T[j] = nrm * (Il[j] + p * Im[j] + Ir[j]);
+    }
+}
+
+// convolve I by a 2r+1 x 2r+1 ones filter
+inline void convBox(float* I, float* O, int h, int w, int d, int r, int s)
+{
+    float nrm = 1.0f / ((2 * r + 1) * (2 * r + 1));
+    int i, j, k = (s - 1) / 2, h0, h1, w0;
+    if (h % 4 == 0)
+    {
+        h0 = h1 = h;
+    }
+    else
+    {
+        h0 = h - (h % 4);
+        h1 = h0 + 4;
+    }
+    w0 = (w / s) * s;
+    ScratchScope scratch;
+    auto* T = reinterpret_cast<float*>(alScratch(h1 * sizeof(float), 16));
+    while (d-- > 0)
+    {
+        // initialize T
+        memset(T, 0, h1 * sizeof(float));
+        for (i = 0; i <= r; i++)
+        {
+            addSpan<Simd128>(T, I + i * h, addSpan<ACF_SIMD>(T, I + i * h, 0, h0), h0);
+        }
+        boxInitSpan<Simd128>(T, I + r * h, nrm, boxInitSpan<ACF_SIMD>(T, I + r * h, nrm, 0, h0), h0);
+        for (i = 0; i <= r; i++)
+        {
+            for (j = h0; j < h; j++)
+            {
+                T[j] += I[j + i * h];
+            }
+        }
+        for (j = h0; j < h; j++)
+        {
+            T[j] = nrm * (2 * T[j] - I[j + r * h]);
+        }
+        // prepare and convolve each column in turn
+        k++;
+        if (k == s)
+        {
+            k = 0;
+            convBoxY(T, O, h, r, s);
+            O += h / s;
+        }
+        for (i = 1; i < w0; i++)
+        {
+            float* Il = I + (i - 1 - r) * h;
+            if (i <= r)
+            {
+                Il = I + (r - i) * h;
+            }
+            float* Ir = I + (i + r) * h;
+            if (i >= w - r)
+            {
+                Ir = I + (2 * w - r - i - 1) * h;
+            }
+            boxStepSpan<Simd128>(T, Il, Ir, nrm, boxStepSpan<ACF_SIMD>(T, Il, Ir, nrm, 0, h0), h0);
+            for (j = h0; j < h; j++)
+            {
+                T[j] -= nrm * (Il[j] - Ir[j]);
+            }
+            k++;
+            if (k == s)
+            {
+                k = 0;
+                convBoxY(T, O, h, r, s);
+                O += h / s;
+            }
+        }
+        I += w * h;
+    }
+}
+
+// convolve I by a 2rx1 triangle filter
+inline void convTri(float* I, float* O, int h, int w, int d, int r, int s)
+{
+    r++;
+    float nrm = 1.0f / (r * r * r * r);
+    int i, k = (s - 1) / 2, h0, h1, w0;
+    if (h % 4 == 0)
+    {
+        h0 = h1 = h;
+    }
+    else
+    {
+        h0 = h - (h % 4);
+        h1 = h0 + 4;
+    }
+    w0 = (w / s) * s;
+    ScratchScope scratch;
+    float *T = reinterpret_cast<float*>(alScratch(2 * h1 * sizeof(float), 16)), *U = T + h1;
+    while (d-- > 0)
+    {
+        // initialize T and U
+        convTriInit(I, T, U, h, h0, r, nrm);
+        // prepare and convolve each column in turn
+        k++;
+        if (k == s)
+        {
+            k = 0;
+            convTriY(U, O, h, r - 1, s);
+            O += h / s;
+        }
+        for (i = 1; i < w0; i++)
+        {
+            float* Il = I + (i - 1 - r) * h;
+            if (i <= r)
+            {
+                Il = I + (r - i) * h;
+            }
+            float* Im = I + (i - 1) * h;
+            float* Ir = I + (i - 1 + r) * h;
+            if (i > w - r)
+            {
+                Ir = I + (2 * w - r - i) * h;
+            }
+            convTriStep(Il, Im, Ir, T, U, h, h0, nrm);
+            k++;
+            if (k == s)
+            {
+                k = 0;
+                convTriY(U, O, h, r - 1, s);
+                O += h / s;
+            }
+        }
+        I += w * h;
+    }
+}
+
+// convolve I by a [1 p 1] filter
+inline void convTri1(float* I, float* O, int h, int w, int d, float p, int s)
+{
+    const float nrm = 1.0f / ((p + 2) * (p + 2));
+    int i, h0 = h - (h % 4);
+    ScratchScope scratch;
+    float *Il, *Im, *Ir, *T = reinterpret_cast<float*>(alScratch(h * sizeof(float), 16));
+    for (int d0 = 0; d0 < d; d0++)
+    {
+        for (i = s / 2; i < w; i += s)
+        {
+            Il = Im = Ir = I + i * h + d0 * h * w;
+            if (i > 0)
+            {
+                Il -= h;
+            }
+            if (i < w - 1)
+            {
+                Ir += h;
+            }
+            convTri1Step(Il, Im, Ir, T, h, h0, nrm, p);
+            convTri1Y(T, O, h, p, s);
+            O += h / s;
+        }
+    }
+}
@@ -6,6 +6,7 @@
 *******************************************************************************/
 #include <acf/toolbox/wrappers.hpp>
 #include <acf/toolbox/sse.hpp>
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 
@@ -164,113 +165,92 @@ private:
     void operator=(ACosTable const&) = delete;
 };
 
-// compute gradient magnitude and orientation at each location (uses sse)
-void gradMag(float* I, float* M, float* O, int h, int w, int d, bool full)
+#define ACF_SIMD_KERNELS <acf/toolbox/gradientMexKernels.hpp>
+#include <acf/toolbox/simdDispatch.hpp>
+
+// compute gradient magnitude and orientation of column x, where I, M and O point to the column
+// and Gx, Gy and M2 hold d columns of h4 values (h rounded up to a multiple of 4)
+void gradMagColumn(float* I, float* M, float* O, float* Gx, float* Gy, float* M2, int h, int w, int d, int x, bool full)
 {
-    int x, y, y1, c, h4, s;
-    float *Gx, *Gy, *M2;
-    __m128 *_Gx, *_Gy, *_M2, _m;
+    int y, y1, c, h4 = (h % 4 == 0) ? h : h - (h % 4) + 4;
     auto acMult = float(ACosTable::n);
-    // allocate memory for storing one column of output (padded so h4%4==0)
-    h4 = (h % 4 == 0) ? h : h - (h % 4) + 4;
-    s = d * h4 * sizeof(float);
-    M2 = reinterpret_cast<float*>(alMalloc(s, 16));
-    _M2 = reinterpret_cast<__m128*>(M2);
-    Gx = reinterpret_cast<float*>(alMalloc(s, 16));
-    _Gx = reinterpret_cast<__m128*>(Gx);
-    Gy = reinterpret_cast<float*>(alMalloc(s, 16));
-    _Gy = reinterpret_cast<__m128*>(Gy);
 
-    __m128 upper = SET(static_cast<float>(ACosTable::getInstance().max()));
-    __m128 lower = SET(static_cast<float>(ACosTable::getInstance().min()));
+    const auto upper = static_cast<float>(ACosTable::getInstance().max());
+    const auto lower = static_cast<float>(ACosTable::getInstance().min());
 
-    // compute gradient magnitude and orientation for each column
-    for (x = 0; x < w; x++)
+    // compute gradients (Gx, Gy) with maximum squared magnitude (M2)
+    for (c = 0; c < d; c++)
+    {
+        grad1(I + c * w * h, Gx + c * h4, Gy + c * h4, h, w, x);
+        ACF_SIMD_DISPATCH(gradMagMax, Gx, Gy, M2, h4, c);
+    }
+    // compute gradient mangitude (M) and normalize Gx
+    ACF_SIMD_DISPATCH(gradMagNormalize, Gx, Gy, M2, h4, acMult, upper, lower, O != nullptr);
+    memcpy(M, M2, h * sizeof(float));
+    // compute and store gradient orientation (O) via table lookup
+    if (O != nullptr)
     {
-        // compute gradients (Gx, Gy) with maximum squared magnitude (M2)
-        for (c = 0; c < d; c++)
+        for (y = 0; y < h; y++)
         {
-            grad1(I + x * h + c * w * h, Gx + c * h4, Gy + c * h4, h, w, x);
-            for (y = 0; y < h4 / 4; y++)
-            {
-                y1 = h4 / 4 * c + y;
-                _M2[y1] = ADD(MUL(_Gx[y1], _Gx[y1]), MUL(_Gy[y1], _Gy[y1]));
-                if (c == 0)
-                {
-                    continue;
-                }
-                _m = CMPGT(_M2[y1], _M2[y]);
-                _M2[y] = OR(AND(_m, _M2[y1]), ANDNOT(_m, _M2[y]));
-                _Gx[y] = OR(AND(_m, _Gx[y1]), ANDNOT(_m, _Gx[y]));
-                _Gy[y] = OR(AND(_m, _Gy[y1]), ANDNOT(_m, _Gy[y]));
-            }
+            O[y] = ACosTable::getInstance()[static_cast<int>(Gx[y])];
         }
-        // compute gradient mangitude (M) and normalize Gx
-        for (y = 0; y < h4 / 4; y++)
+
+        if (full)
         {
-            _m = MIN_sse(RCPSQRT(_M2[y]), SET(1e10f));
-            _M2[y] = RCP(_m);
-            if (O)
+            y1 = ((~size_t(O) + 1) & 15) / 4;
+            y = 0;
+            for (; y < y1; y++)
             {
-                _Gx[y] = MUL(MUL(_Gx[y], _m), SET(acMult));
-                _Gx[y] = XOR(_Gx[y], AND(_Gy[y], SET(-0.f)));
-                _Gx[y] = MAX_sse(MIN_sse(_Gx[y], upper), lower); // prevent: NaN, -0.0
+                O[y] += (Gy[y] < 0) * PI;
             }
-        };
-        memcpy(M + x * h, M2, h * sizeof(float));
-        // compute and store gradient orientation (O) via table lookup
-        if (O != nullptr)
-        {
-            for (y = 0; y < h; y++)
+            for (; y < h - 4; y += 4)
             {
-                O[x * h + y] = ACosTable::getInstance()[static_cast<int>(Gx[y])];
+                STRu(O[y], ADD(LDu(O[y]), AND(CMPLT(LDu(Gy[y]), SET(0.f)), SET(PI))));
             }
-
-            if (full)
+            for (; y < h; y++)
             {
-                y1 = ((~size_t(O + x * h) + 1) & 15) / 4;
-                y = 0;
-                for (; y < y1; y++)
-                {
-                    O[y + x * h] += (Gy[y] < 0) * PI;
-                }
-                for (; y < h - 4; y += 4)
-                {
-                    STRu(O[y + x * h], ADD(LDu(O[y + x * h]), AND(CMPLT(LDu(Gy[y]), SET(0.f)), SET(PI))));
-                }
-                for (; y < h; y++)
-                {
-                    O[y + x * h] += (Gy[y] < 0) * PI;
-                }
+                O[y] += (Gy[y] < 0) * PI;
             }
         }
     }
-    alFree(Gx);
-    alFree(Gy);
-    alFree(M2);
 }
 
-// normalize gradient magnitude at each location (uses sse)
-void gradMagNorm(float* M, float* S, int h, int w, float norm)
+// compute gradient magnitude and orientation at each location (uses sse/avx)
+void gradMag(float* I, float* M, float* O, int h, int w, int d, bool full)
 {
-    __m128 *_pM, *_pS, _norm;
-    int i = 0, n = h * w, n4 = n / 4;
-    _pS = reinterpret_cast<__m128*>(S);
-    _pM = reinterpret_cast<__m128*>(M);
-    _norm = SET(norm);
-    bool sse = !(size_t(M) & 15) && !(size_t(S) & 15);
-    if (sse)
+    int x, h4, s;
+    float *Gx, *Gy, *M2;
+    // allocate memory for storing one column of output (padded so h4%4==0)
+    ScratchScope scratch;
+    h4 = (h % 4 == 0) ? h : h - (h % 4) + 4;
+    s = d * h4 * sizeof(float);
+    M2 = reinterpret_cast<float*>(alScratch(s, 16));
+    Gx = reinterpret_cast<float*>(alScratch(s, 16));
+    Gy = reinterpret_cast<float*>(alScratch(s, 16));
+
+    // compute gradient magnitude and orientation for each column
+    for (x = 0; x < w; x++)
     {
-        for (; i < n4; i++)
-        {
-            *_pM = MUL(*_pM, RCP(ADD(*_pS++, _norm)));
-            _pM++;
-        }
-        i *= 4;
+        gradMagColumn(I + x * h, M + x * h, O ? O + x * h : nullptr, Gx, Gy, M2, h, w, d, x, full);
     }
-    for (; i < n; i++)
+}
+
+// normalize gradient magnitude at each location (uses sse/avx)
+void gradMagNorm(float* M, float* S, int h, int w, float norm)
+{
+    ACF_SIMD_DISPATCH(gradMagNorm, M, S, h, w, norm);
+}
+
+// normalize column x of the gradient magnitude (M and S point to the column) as gradMagNorm()
+// does for the whole image, assuming M and S are aligned there so it takes the sse path
+void gradMagNormColumn(float* M, float* S, int h, int w, int x, float norm)
+{
+    const int n = h * w, n4 = n - (n % 4);
+    int y = std::min(h, std::max(0, n4 - x * h));
+    ACF_SIMD_DISPATCH(gradMagNormRcp, M, S, y, norm);
+    for (; y < h; y++)
     {
-        M[i] /= (S[i] + norm);
+        M[y] /= (S[y] + norm);
     }
 }
 
@@ -371,166 +351,160 @@ void gradQuantize(float* O, float* M, int* O0, int* O1, float* M0, float* M1, in
     }
 }
 
-// compute nOrients gradient histograms per bin x bin block of pixels
-void gradHist(float* M, float* O, float* H, int h, int w, int bin, int nOrients, int softBin, bool full)
+// accumulate column x of M and O (pointing to the column) into H, see gradHist(); O0, O1, M0
+// and M1 are scratch columns of h values and xb carries the spatial bin position from column
+// to column.  Returns false once the remaining columns don't contribute.
+bool gradHistColumn(float* M, float* O, float* H, int* O0, int* O1, float* M0, float* M1, int h, int w, int bin, int nOrients, int softBin, bool full, int x, float& xb)
 {
-    const int hb = h / bin, wb = w / bin, h0 = hb * bin, w0 = wb * bin, nb = wb * hb;
+    const int hb = h / bin, wb = w / bin, h0 = hb * bin, nb = wb * hb;
     const float s = static_cast<float>(bin), sInv = 1 / s, sInv2 = 1 / s / s;
-    float *H0, *H1, *M0, *M1;
-    int x, y;
-    int *O0, *O1;
-    float xb, init;
-    O0 = reinterpret_cast<int*>(alMalloc(h * sizeof(int), 16));
-    M0 = reinterpret_cast<float*>(alMalloc(h * sizeof(float), 16));
-    O1 = reinterpret_cast<int*>(alMalloc(h * sizeof(int), 16));
-    M1 = reinterpret_cast<float*>(alMalloc(h * sizeof(float), 16));
-    // main loop
-    for (x = 0; x < w0; x++)
-    {
-        // compute target orientation bins for entire column - very fast
-        gradQuantize(O + x * h, M + x * h, O0, O1, M0, M1, nb, h0, sInv2, nOrients, full, softBin >= 0);
+    const float init = (0 + .5f) * sInv - 0.5f;
+    float *H0, *H1;
+    int y;
 
-        if (softBin < 0 && softBin % 2 == 0)
-        {
-            // no interpolation w.r.t. either orienation or spatial bin
-            H1 = H + (x / bin) * hb;
+    // compute target orientation bins for entire column - very fast
+    gradQuantize(O, M, O0, O1, M0, M1, nb, h0, sInv2, nOrients, full, softBin >= 0);
+
+    if (softBin < 0 && softBin % 2 == 0)
+    {
+        // no interpolation w.r.t. either orienation or spatial bin
+        H1 = H + (x / bin) * hb;
 #define GH              \
     H1[O0[y]] += M0[y]; \
     y++;
-            if (bin == 1)
+        if (bin == 1)
+        {
+            for (y = 0; y < h0;)
             {
-                for (y = 0; y < h0;)
-                {
-                    GH;
-                    H1++;
-                }
+                GH;
+                H1++;
             }
-            else if (bin == 2)
+        }
+        else if (bin == 2)
+        {
+            for (y = 0; y < h0;)
             {
-                for (y = 0; y < h0;)
-                {
-                    GH;
-                    GH;
-                    H1++;
-                }
+                GH;
+                GH;
+                H1++;
             }
-            else if (bin == 3)
+        }
+        else if (bin == 3)
+        {
+            for (y = 0; y < h0;)
             {
-                for (y = 0; y < h0;)
-                {
-                    GH;
-                    GH;
-                    GH;
-                    H1++;
-                }
+                GH;
+                GH;
+                GH;
+                H1++;
             }
-            else if (bin == 4)
+        }
+        else if (bin == 4)
+        {
+            for (y = 0; y < h0;)
             {
-                for (y = 0; y < h0;)
-                {
-                    GH;
-                    GH;
-                    GH;
-                    GH;
-                    H1++;
-                }
+                GH;
+                GH;
+                GH;
+                GH;
+                H1++;
             }
-            else
+        }
+        else
+        {
+            for (y = 0; y < h0;)
             {
-                for (y = 0; y < h0;)
+                for (int y1 = 0; y1 < bin; y1++)
                 {
-                    for (int y1 = 0; y1 < bin; y1++)
-                    {
-                        GH;
-                    }
-                    H1++;
+                    GH;
                 }
+                H1++;
             }
-#undef GH
         }
-        else if (softBin % 2 == 0 || bin == 1)
-        {
-            // interpolate w.r.t. orientation only, not spatial bin
-            H1 = H + (x / bin) * hb;
+#undef GH
+    }
+    else if (softBin % 2 == 0 || bin == 1)
+    {
+        // interpolate w.r.t. orientation only, not spatial bin
+        H1 = H + (x / bin) * hb;
 #define GH              \
     H1[O0[y]] += M0[y]; \
     H1[O1[y]] += M1[y]; \
     y++;
-            if (bin == 1)
+        if (bin == 1)
+        {
+            for (y = 0; y < h0;)
             {
-                for (y = 0; y < h0;)
-                {
-                    GH;
-                    H1++;
-                }
+                GH;
+                H1++;
             }
-            else if (bin == 2)
+        }
+        else if (bin == 2)
+        {
+            for (y = 0; y < h0;)
             {
-                for (y = 0; y < h0;)
-                {
-                    GH;
-                    GH;
-                    H1++;
-                }
+                GH;
+                GH;
+                H1++;
             }
-            else if (bin == 3)
+        }
+        else if (bin == 3)
+        {
+            for (y = 0; y < h0;)
             {
-                for (y = 0; y < h0;)
-                {
-                    GH;
-                    GH;
-                    GH;
-                    H1++;
-                }
+                GH;
+                GH;
+                GH;
+                H1++;
             }
-            else if (bin == 4)
+        }
+        else if (bin == 4)
+        {
+            for (y = 0; y < h0;)
             {
-                for (y = 0; y < h0;)
-                {
-                    GH;
-                    GH;
-                    GH;
-                    GH;
-                    H1++;
-                }
+                GH;
+                GH;
+                GH;
+                GH;
+                H1++;
             }
-            else
+        }
+        else
+        {
+            for (y = 0; y < h0;)
             {
-                for (y = 0; y < h0;)
+                for (int y1 = 0; y1 < bin; y1++)
                 {
-                    for (int y1 = 0; y1 < bin; y1++)
-                    {
-                        GH;
-                    }
-                    H1++;
+                    GH;
                 }
+                H1++;
             }
-#undef GH
         }
-        else
+#undef GH
+    }
+    else
+    {
+        // interpolate using trilinear interpolation
+        float ms[4], xyd, yb, xd, yd;
+        __m128 _m, _m0, _m1;
+        bool hasLf, hasRt;
+        int xb0, yb0;
+        if (x == 0)
         {
-            // interpolate using trilinear interpolation
-            float ms[4], xyd, yb, xd, yd;
-            __m128 _m, _m0, _m1;
-            bool hasLf, hasRt;
-            int xb0, yb0;
-            if (x == 0)
-            {
-                init = (0 + .5f) * sInv - 0.5f;
-                xb = init;
-            }
-            hasLf = xb >= 0;
-            xb0 = hasLf ? static_cast<int>(xb) : -1;
+            xb = init;
+        }
+        hasLf = xb >= 0;
+        xb0 = hasLf ? static_cast<int>(xb) : -1;
 
-            if (xb0 >= (wb - 1))
-            {
-                break;
-            }
-            hasRt = xb0 < wb - 4; // FIX: SSE access
-            xd = xb - xb0;
-            xb += sInv;
-            yb = init;
-            y = 0;
+        if (xb0 >= (wb - 1))
+        {
+            return false;
+        }
+        hasRt = xb0 < wb - 4; // FIX: SSE access
+        xd = xb - xb0;
+        xb += sInv;
+        yb = init;
+        y = 0;
 // macros for code conciseness
 #define GHinit                 \
     yd = yb - yb0;             \
@@ -544,97 +518,99 @@ void gradHist(float* M, float* O, float* H, int h, int w, int bin, int nOrients,
 #define GH(H, ma, mb) \
     H1 = H;           \
     STRu(*H1, ADD(LDu(*H1), MUL(ma, mb)));
-            // leading rows, no top bin
-            for (; y < bin / 2; y++)
+        // leading rows, no top bin
+        for (; y < bin / 2; y++)
+        {
+            yb0 = -1;
+            GHinit;
+            if (hasLf)
             {
-                yb0 = -1;
+                H0[O0[y] + 1] += ms[1] * M0[y];
+                H0[O1[y] + 1] += ms[1] * M1[y];
+            }
+            if (hasRt)
+            {
+                H0[O0[y] + hb + 1] += ms[3] * M0[y];
+                H0[O1[y] + hb + 1] += ms[3] * M1[y];
+            }
+        }
+        // main rows, has top and bottom bins, use SSE for minor speedup
+        if (softBin < 0)
+        {
+            for (;; y++)
+            {
+                yb0 = static_cast<int>(yb);
+                if (yb0 >= hb - 1)
+                {
+                    break;
+                }
                 GHinit;
+                _m0 = SET(M0[y]);
                 if (hasLf)
                 {
-                    H0[O0[y] + 1] += ms[1] * M0[y];
-                    H0[O1[y] + 1] += ms[1] * M1[y];
+                    _m = SET(0, 0, ms[1], ms[0]);
+                    GH(H0 + O0[y], _m, _m0);
                 }
                 if (hasRt)
                 {
-                    H0[O0[y] + hb + 1] += ms[3] * M0[y];
-                    H0[O1[y] + hb + 1] += ms[3] * M1[y];
-                }
-            }
-            // main rows, has top and bottom bins, use SSE for minor speedup
-            if (softBin < 0)
-            {
-                for (;; y++)
-                {
-                    yb0 = static_cast<int>(yb);
-                    if (yb0 >= hb - 1)
-                    {
-                        break;
-                    }
-                    GHinit;
-                    _m0 = SET(M0[y]);
-                    if (hasLf)
-                    {
-                        _m = SET(0, 0, ms[1], ms[0]);
-                        GH(H0 + O0[y], _m, _m0);
-                    }
-                    if (hasRt)
-                    {
-                        _m = SET(0, 0, ms[3], ms[2]);
-                        GH(H0 + O0[y] + hb, _m, _m0);
-                    }
+                    _m = SET(0, 0, ms[3], ms[2]);
+                    GH(H0 + O0[y] + hb, _m, _m0);
                 }
             }
-            else
+        }
+        else
+        {
+            for (;; y++)
             {
-                for (;; y++)
+                yb0 = static_cast<int>(yb);
+                if (yb0 >= hb - 1)
                 {
-                    yb0 = static_cast<int>(yb);
-                    if (yb0 >= hb - 1)
-                    {
-                        break;
-                    }
-                    GHinit;
-                    _m0 = SET(M0[y]);
-                    _m1 = SET(M1[y]);
-                    if (hasLf)
-                    {
-                        _m = SET(0, 0, ms[1], ms[0]);
-                        GH(H0 + O0[y], _m, _m0);
-                        GH(H0 + O1[y], _m, _m1);
-                    }
-                    if (hasRt)
-                    {
-                        _m = SET(0, 0, ms[3], ms[2]);
-                        GH(H0 + O0[y] + hb, _m, _m0);
-                        GH(H0 + O1[y] + hb, _m, _m1);
-                    }
+                    break;
                 }
-            }
-            // final rows, no bottom bin
-            for (; y < h0; y++)
-            {
-                yb0 = static_cast<int>(yb);
                 GHinit;
+                _m0 = SET(M0[y]);
+                _m1 = SET(M1[y]);
                 if (hasLf)
                 {
-                    H0[O0[y]] += ms[0] * M0[y];
-                    H0[O1[y]] += ms[0] * M1[y];
+                    _m = SET(0, 0, ms[1], ms[0]);
+                    GH(H0 + O0[y], _m, _m0);
+                    GH(H0 + O1[y], _m, _m1);
                 }
                 if (hasRt)
                 {
-                    H0[O0[y] + hb] += ms[2] * M0[y];
-                    H0[O1[y] + hb] += ms[2] * M1[y];
+                    _m = SET(0, 0, ms[3], ms[2]);
+                    GH(H0 + O0[y] + hb, _m, _m0);
+                    GH(H0 + O1[y] + hb, _m, _m1);
                 }
             }
+        }
+        // final rows, no bottom bin
+        for (; y < h0; y++)
+        {
+            yb0 = static_cast<int>(yb);
+            GHinit;
+            if (hasLf)
+            {
+                H0[O0[y]] += ms[0] * M0[y];
+                H0[O1[y]] += ms[0] * M1[y];
+            }
+            if (hasRt)
+            {
+                H0[O0[y] + hb] += ms[2] * M0[y];
+                H0[O1[y] + hb] += ms[2] * M1[y];
+            }
+        }
 #undef GHinit
 #undef GH
-        }
     }
-    alFree(O0);
-    alFree(O1);
-    alFree(M0);
-    alFree(M1);
-    // normalize boundary bins which only get 7/8 of weight of interior bins
+    return true;
+}
+
+// normalize boundary bins of H which only get 7/8 of weight of interior bins (see gradHist)
+void gradHistNormalize(float* H, int h, int w, int bin, int nOrients, int softBin)
+{
+    const int hb = h / bin, wb = w / bin, nb = wb * hb;
+    int x, y;
     if (softBin % 2 != 0)
     {
         for (int o = 0; o < nOrients; o++)
@@ -663,15 +639,38 @@ void gradHist(float* M, float* O, float* H, int h, int w, int bin, int nOrients,
     }
 }
 
+// compute nOrients gradient histograms per bin x bin block of pixels
+void gradHist(float* M, float* O, float* H, int h, int w, int bin, int nOrients, int softBin, bool full)
+{
+    const int w0 = (w / bin) * bin;
+    float *M0, *M1, xb = 0.f;
+    int *O0, *O1;
+    ScratchScope scratch;
+    O0 = reinterpret_cast<int*>(alScratch(h * sizeof(int), 16));
+    M0 = reinterpret_cast<float*>(alScratch(h * sizeof(float), 16));
+    O1 = reinterpret_cast<int*>(alScratch(h * sizeof(int), 16));
+    M1 = reinterpret_cast<float*>(alScratch(h * sizeof(float), 16));
+    // main loop
+    for (int x = 0; x < w0; x++)
+    {
+        if (!gradHistColumn(M + x * h, O + x * h, H, O0, O1, M0, M1, h, w, bin, nOrients, softBin, full, x, xb))
+        {
+            break;
+        }
+    }
+    gradHistNormalize(H, h, w, bin, nOrients, softBin);
+}
+
 /******************************************************************************/
 
-// HOG helper: compute 2x2 block normalization values (padded by 1 pixel)
+// HOG helper: compute 2x2 block normalization values (padded by 1 pixel), in scratch memory
+// of the caller's ScratchScope
 float* hogNormMatrix(float* H, int nOrients, int hb, int wb, int bin)
 {
     float *N, *N1, *n;
     int o, x, y, dx, dy, hb1 = hb + 1, wb1 = wb + 1;
     float eps = 1e-4f / 4 / bin / bin / bin / bin; // precise backward equality
-    N = reinterpret_cast<float*>(wrCalloc(hb1 * wb1, sizeof(float)));
+    N = reinterpret_cast<float*>(alScratchCalloc(hb1 * wb1, sizeof(float), 16));
     N1 = N + hb1 + 1;
     for (o = 0; o < nOrients; o++)
     {
@@ -819,14 +818,13 @@ void hog(float* M, float* O, float* H, int h, int w, int binSize, int nOrients,
     float *N, *R;
     const int hb = h / binSize, wb = w / binSize; /*, nb=hb*wb; */
     // compute unnormalized gradient histograms
-    R = reinterpret_cast<float*>(wrCalloc(wb * hb * nOrients, sizeof(float)));
+    ScratchScope scratch;
+    R = reinterpret_cast<float*>(alScratchCalloc(wb * hb * nOrients, sizeof(float), 16));
     gradHist(M, O, R, h, w, binSize, nOrients, softBin, full);
     // compute block normalization values
     N = hogNormMatrix(R, nOrients, hb, wb, binSize);
     // perform four normalizations per spatial block
     hogChannels(H, R, N, hb, wb, nOrients, clip, 0);
-    wrFree(N);
-    wrFree(R);
 }
 
 // compute FHOG features
@@ -836,10 +834,11 @@ void fhog(float* M, float* O, float* H, int h, int w, int binSize, int nOrients,
     float *N, *R1, *R2;
     int o, x;
     // compute unnormalized constrast sensitive histograms
-    R1 = reinterpret_cast<float*>(wrCalloc(wb * hb * nOrients * 2, sizeof(float)));
+    ScratchScope scratch;
+    R1 = reinterpret_cast<float*>(alScratchCalloc(wb * hb * nOrients * 2, sizeof(float), 16));
     gradHist(M, O, R1, h, w, binSize, nOrients * 2, softBin, true);
     // compute unnormalized contrast insensitive histograms
-    R2 = reinterpret_cast<float*>(wrCalloc(wb * hb * nOrients, sizeof(float)));
+    R2 = reinterpret_cast<float*>(alScratchCalloc(wb * hb * nOrients, sizeof(float), 16));
     for (o = 0; o < nOrients; o++)
     {
         for (x = 0; x < nb; x++)
@@ -853,9 +852,6 @@ void fhog(float* M, float* O, float* H, int h, int w, int binSize, int nOrients,
     hogChannels(H + nbo * 0, R1, N, hb, wb, nOrients * 2, clip, 1);
     hogChannels(H + nbo * 2, R2, N, hb, wb, nOrients * 1, clip, 1);
     hogChannels(H + nbo * 3, R1, N, hb, wb, nOrients * 2, clip, 2);
-    wrFree(N);
-    wrFree(R1);
-    wrFree(R2);
 }
 
 /******************************************************************************/
@@ -0,0 +1,106 @@
+/*! -*-c++-*-
+  @file   gradientMexKernels.hpp
+  @author David Hirvonen
+  @brief  Width generic gradient magnitude kernels for gradientMex.cpp.
+
+  \copyright Copyright 2018 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  No include guard: compiled once per SIMD backend ACF_SIMD through simdDispatch.hpp (see
+  convConstKernels.hpp for the span convention).
+
+*/
+
+template <typename V>
+inline int gradMagMaxSpan(float* Gx, float* Gy, float* M2, int h4, int c, int y, int n)
+{
+    const int y1 = h4 * c;
+    for (; y + V::kWidth <= n; y += V::kWidth)
+    {
+        const typename V::F gx = V::load(Gx + y1 + y), gy = V::load(Gy + y1 + y);
+        const typename V::F m2 = V::add(V::mul(gx, gx), V::mul(gy, gy));
+        V::store(M2 + y1 + y, m2);
+        if (c == 0)
+        {
+            continue;
+        }
+        const typename V::F m20 = V::load(M2 + y);
+        const typename V::M m = V::greater(m2, m20);
+        V::store(M2 + y, V::select(m, m2, m20));
+        V::store(Gx + y, V::select(m, gx, V::load(Gx + y)));
+        V::store(Gy + y, V::select(m, gy, V::load(Gy + y)));
+    }
+    return y;
+}
+
+template <typename V>
+inline int gradMagNormalizeSpan(float* Gx, float* Gy, float* M2, float acMult, float upper, float lower, bool orient, int y, int n)
+{
+    const typename V::F vBig = V::set(1e10f), vMult = V::set(acMult), vSign = V::set(-0.f);
+    const typename V::F vUpper = V::set(upper), vLower = V::set(lower);
+    for (; y + V::kWidth <= n; y += V::kWidth)
+    {
+        const typename V::F m = V::min(V::rcpsqrt(V::load(M2 + y)), vBig);
+        V::store(M2 + y, V::rcp(m));
+        if (orient)
+        {
+            typename V::F gx = V::mul(V::mul(V::load(Gx + y), m), vMult);
+            gx = V::bitXor(gx, V::bitAnd(V::load(Gy + y), vSign));
+            V::store(Gx + y, V::max(V::min(gx, vUpper), vLower)); // prevent: NaN, -0.0
+        }
+    }
+    return y;
+}
+
+template <typename V>
+inline int gradMagNormSpan(float* M, const float* S, float norm, int i, int n)
+{
+    const typename V::F vNorm = V::set(norm);
+    for (; i + V::kWidth <= n; i += V::kWidth)
+    {
+        V::store(M + i, V::mul(V::load(M + i), V::rcp(V::add(V::load(S + i), vNorm))));
+    }
+    return i;
+}
+
+// compute the squared magnitude of channel c in M2 and keep the strongest channel in slot 0
+inline void gradMagMax(float* Gx, float* Gy, float* M2, int h4, int c)
+{
+    gradMagMaxSpan<Simd128>(Gx, Gy, M2, h4, c, gradMagMaxSpan<ACF_SIMD>(Gx, Gy, M2, h4, c, 0, h4), h4);
+}
+
+// compute gradient magnitude (M2) and normalized Gx for the table lookup
+inline void gradMagNormalize(float* Gx, float* Gy, float* M2, int h4, float acMult, float upper, float lower, bool orient)
+{
+    int y = gradMagNormalizeSpan<ACF_SIMD>(Gx, Gy, M2, acMult, upper, lower, orient, 0, h4);
+    gradMagNormalizeSpan<Simd128>(Gx, Gy, M2, acMult, upper, lower, orient, y, h4);
+}
+
+// normalize the first n values of M with the reciprocal approximation used by gradMagNorm(),
+// for any n and alignment; the lanes are independent so the remainder goes in a padded vector
+inline void gradMagNormRcp(float* M, const float* S, int n, float norm)
+{
+    int i = gradMagNormSpan<Simd128>(M, S, norm, gradMagNormSpan<ACF_SIMD>(M, S, norm, 0, n), n);
+    if (i < n)
+    {
+        float m[4] = { 0.f, 0.f, 0.f, 0.f }, s[4] = { 1.f, 1.f, 1.f, 1.f };
+        std::copy(M + i, M + n, m);
+        std::copy(S + i, S + n, s);
+        gradMagNormSpan<Simd128>(m, s, norm, 0, 4);
+        std::copy(m, m + (n - i), M + i);
+    }
+}
+
+// normalize gradient magnitude at each location
+inline void gradMagNorm(float* M, float* S, int h, int w, float norm)
+{
+    int i = 0, n = h * w;
+    if (!(size_t(M) & 15) && !(size_t(S) & 15))
+    {
+        i = gradMagNormSpan<Simd128>(M, S, norm, gradMagNormSpan<ACF_SIMD>(M, S, norm, 0, n), n);
+    }
+    for (; i < n; i++)
+    {
+        M[i] /= (S[i] + norm);
+    }
+}
@@ -69,11 +69,12 @@ void imPad(T* A, T* B, int h, int w, int d, int pt, int pb, int pl, int pr, int
         for (y = h1; y < hb; y++)                       \
             B[x * hb + y] = A[(XR - cr) * h + YB - cb];
     // build lookup table for xs and ys if necessary
+    ScratchScope scratch;
     if (useLookup)
     {
-        xs = reinterpret_cast<int*>(wrMalloc(wb * sizeof(int)));
+        xs = reinterpret_cast<int*>(alScratch(wb * sizeof(int), 16));
         int h2 = (pt + 1) * 2 * h;
-        ys = reinterpret_cast<int*>(wrMalloc(hb * sizeof(int)));
+        ys = reinterpret_cast<int*>(alScratch(hb * sizeof(int), 16));
         int w2 = (pl + 1) * 2 * w;
         if (flag == 2)
         {
@@ -159,11 +160,6 @@ void imPad(T* A, T* B, int h, int w, int d, int pt, int pb, int pl, int pr, int
         A += h * w;
         B += hb * wb;
     }
-    if (useLookup)
-    {
-        wrFree(xs);
-        wrFree(ys);
-    }
 #undef PAD
 }
 
@@ -0,0 +1,80 @@
+/*! -*-c++-*-
+  @file   imResampleKernels.hpp
+  @author David Hirvonen
+  @brief  Width generic x passes of the bilinear resampling in imResampleMex.cpp.
+
+  \copyright Copyright 2018 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  No include guard: compiled once per SIMD backend ACF_SIMD through simdDispatch.hpp (see
+  convConstKernels.hpp for the span convention).  The kernels advance y past the values they
+  computed and leave the rest of the column to the scalar loops in resample().
+
+*/
+
+// C = A[0] + ... + A[m - 1], 2 <= m <= 4
+template <typename V>
+inline int resampleSumSpan(float* C, float* const* A, int m, int y, int n)
+{
+    for (; y + V::kWidth <= n; y += V::kWidth)
+    {
+        typename V::F c = V::add(V::load(A[0] + y), V::load(A[1] + y));
+        for (int k = 2; k < m; k++)
+        {
+            c = V::add(c, V::load(A[k] + y));
+        }
+        V::store(C + y, c);
+    }
+    return y;
+}
+
+// C = A[0] * wts[0] + ... + A[m - 1] * wts[m - 1], 1 <= m <= 4
+template <typename V>
+inline int resampleWeightedSpan(float* C, float* const* A, const float* wts, int m, int y, int n)
+{
+    typename V::F w[4];
+    for (int k = 0; k < m; k++)
+    {
+        w[k] = V::set(wts[k]);
+    }
+    for (; y + V::kWidth <= n; y += V::kWidth)
+    {
+        typename V::F c = V::mul(V::load(A[0] + y), w[0]);
+        for (int k = 1; k < m; k++)
+        {
+            c = V::add(c, V::mul(V::load(A[k] + y), w[k]));
+        }
+        V::store(C + y, c);
+    }
+    return y;
+}
+
+// C += A * wt
+template <typename V>
+inline int resampleAccumulateSpan(float* C, const float* A, float wt, int y, int n)
+{
+    const typename V::F vWt = V::set(wt);
+    for (; y + V::kWidth <= n; y += V::kWidth)
+    {
+        V::store(C + y, V::add(V::load(C + y), V::mul(V::load(A + y), vWt)));
+    }
+    return y;
+}
+
+// sum m consecutive columns of A (integer downsampling)
+inline void resampleSum(float* C, float* const* A, int m, int& y, int n)
+{
+    y = resampleSumSpan<Simd128>(C, A, m, resampleSumSpan<ACF_SIMD>(C, A, m, y, n), n);
+}
+
+// weighted sum of m columns of A (downsampling or bilinear upsampling)
+inline void resampleWeighted(float* C, float* const* A, const float* wts, int m, int& y, int n)
+{
+    y = resampleWeightedSpan<Simd128>(C, A, wts, m, resampleWeightedSpan<ACF_SIMD>(C, A, wts, m, y, n), n);
+}
+
+// add one more weighted column of A (downsampling by more than 4 columns)
+inline void resampleAccumulate(float* C, const float* A, float wt, int& y, int n)
+{
+    y = resampleAccumulateSpan<Simd128>(C, A, wt, resampleAccumulateSpan<ACF_SIMD>(C, A, wt, y, n), n);
+}
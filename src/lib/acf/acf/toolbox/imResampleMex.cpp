@@ -7,20 +7,24 @@
 
 #include <acf/MatP.h>
 #include <acf/toolbox/wrappers.hpp>
-#include <acf/toolbox/sse.hpp>
+#include <acf/toolbox/simd.hpp>
 
 #include <opencv2/core/base.hpp>
 #include <opencv2/core/hal/interface.h>
 #include <opencv2/core/types.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <memory>
 #include <stdexcept>
 #include <typeinfo>
+#include <vector>
 
 using uchar = unsigned char;
 
-// compute interpolation values for single column for resapling
+// compute interpolation values for single column for resapling (in scratch memory of the
+// caller's ScratchScope)
 template <class T>
 void resampleCoef(int ha, int hb, int& n, int*& yas, int*& ybs, T*& wts, int bd[2], int pad = 0)
 {
@@ -39,9 +43,9 @@ void resampleCoef(int ha, int hb, int& n, int*& yas, int*& ybs, T*& wts, int bd[
         n = nMax = hb;
     }
     // initialize memory
-    wts = (T*)alMalloc(nMax * sizeof(T), 16);
-    yas = reinterpret_cast<int*>(alMalloc(nMax * sizeof(int), 16));
-    ybs = reinterpret_cast<int*>(alMalloc(nMax * sizeof(int), 16));
+    wts = (T*)alScratch(nMax * sizeof(T), 16);
+    yas = reinterpret_cast<int*>(alScratch(nMax * sizeof(int), 16));
+    ybs = reinterpret_cast<int*>(alScratch(nMax * sizeof(int), 16));
     if (ds)
     {
         for (int yb = 0; yb < hb; yb++)
@@ -120,9 +124,29 @@ void resampleCoef(int ha, int hb, int& n, int*& yas, int*& ybs, T*& wts, int bd[
     }
 }
 
+// Coefficient tables for a fixed (input, output) size pair along both axes, as produced by
+// resampleCoef(), so repeated resampling at the same geometry skips the table setup.  The
+// y weights are stored before scaling by the normalization constant r.
+struct ImResampleCoef
+{
+    int ha = 0, hb = 0, wa = 0, wb = 0;
+    int wn = 0, hn = 0;
+    int xbd[2] = { 0, 0 }, ybd[2] = { 0, 0 };
+    std::vector<int> xas, xbs, yas, ybs;
+    std::vector<float> xwts, ywts;
+
+    bool matches(int ha_, int hb_, int wa_, int wb_) const
+    {
+        return (ha == ha_) && (hb == hb_) && (wa == wa_) && (wb == wb_);
+    }
+};
+
+#define ACF_SIMD_KERNELS <acf/toolbox/imResampleKernels.hpp>
+#include <acf/toolbox/simdDispatch.hpp>
+
 // resample A using bilinear interpolation and and store result in B
 template <class T>
-void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r)
+void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r, const ImResampleCoef* coef = nullptr)
 {
     CV_Assert(A != nullptr);
     CV_Assert(B != nullptr);
@@ -130,7 +154,8 @@ void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r)
 
     int hn, wn, x, x1, y, z, xa, xb, ya;
     T *A0, *A1, *A2, *A3, *B0, wt, wt1;
-    auto* C = (T*)alMalloc((ha + 4) * sizeof(T), 16);
+    ScratchScope scratch;
+    auto* C = (T*)alScratch((ha + 4) * sizeof(T), 16);
     for (y = ha; y < ha + 4; y++)
     {
         C[y] = 0;
@@ -140,8 +165,29 @@ void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r)
     int *xas, *xbs, *yas, *ybs;
     T *xwts, *ywts;
     int xbd[2], ybd[2];
-    resampleCoef<T>(wa, wb, wn, xas, xbs, xwts, xbd, 0);
-    resampleCoef<T>(ha, hb, hn, yas, ybs, ywts, ybd, 4);
+    const bool cached = coef && (typeid(T) == typeid(float));
+    if (cached)
+    {
+        CV_Assert(coef->matches(ha, hb, wa, wb));
+        wn = coef->wn;
+        hn = coef->hn;
+        std::copy(coef->xbd, coef->xbd + 2, xbd);
+        std::copy(coef->ybd, coef->ybd + 2, ybd);
+        xas = const_cast<int*>(coef->xas.data());
+        xbs = const_cast<int*>(coef->xbs.data());
+        yas = const_cast<int*>(coef->yas.data());
+        ybs = const_cast<int*>(coef->ybs.data());
+        xwts = reinterpret_cast<T*>(const_cast<float*>(coef->xwts.data()));
+
+        // The y weights are scaled by r below, so each call works on a copy:
+        ywts = (T*)alScratch(hn * sizeof(T), 16);
+        memcpy(ywts, coef->ywts.data(), hn * sizeof(float));
+    }
+    else
+    {
+        resampleCoef<T>(wa, wb, wn, xas, xbs, xwts, xbd, 0);
+        resampleCoef<T>(ha, hb, hn, yas, ybs, ywts, ybd, 4);
+    }
     if (wa == 2 * wb)
     {
         r /= 2;
@@ -187,29 +233,31 @@ void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r)
             ywtsf = (float*)ywts;
             wtf = (float)wt;
             wt1f = (float)wt1;
+            float* Afs[4] = { Af0, Af1, Af2, Af3 };
 // resample along x direction (A -> C)
-#define FORs(X)                    \
-    if (sse)                       \
-        for (; y < ha - 4; y += 4) \
-            STR(Cf[y], X);
+#define FORs(kernel, ...)                       \
+    if (sse)                                    \
+    {                                           \
+        ACF_SIMD_DISPATCH(kernel, __VA_ARGS__); \
+    }
 #define FORr(X)         \
     for (; y < ha; y++) \
         C[y] = X;
             if (wa == 2 * wb)
             {
-                FORs(ADD(LDu(Af0[y]), LDu(Af1[y])));
+                FORs(resampleSum, Cf, Afs, 2, y, ha);
                 FORr(A0[y] + A1[y]);
                 x1 += 2;
             }
             else if (wa == 3 * wb)
             {
-                FORs(ADD(LDu(Af0[y]), LDu(Af1[y]), LDu(Af2[y])));
+                FORs(resampleSum, Cf, Afs, 3, y, ha);
                 FORr(A0[y] + A1[y] + A2[y]);
                 x1 += 3;
             }
             else if (wa == 4 * wb)
             {
-                FORs(ADD(LDu(Af0[y]), LDu(Af1[y]), LDu(Af2[y]), LDu(Af3[y])));
+                FORs(resampleSum, Cf, Afs, 4, y, ha);
                 FORr(A0[y] + A1[y] + A2[y] + A3[y]);
                 x1 += 4;
             }
@@ -225,29 +273,24 @@ void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r)
                 {
                     wtsf[x0] = float(xwts[x1 + x0]);
                 }
-#define U(x) MUL(LDu(*(Af##x + y)), SET(wtsf[x]))
 #define V(x) *(A##x + y) * xwts[x1 + x]
+                FORs(resampleWeighted, Cf, Afs, wtsf, (m < 4 ? m : 4), y, ha);
                 if (m == 1)
                 {
-                    FORs(U(0));
                     FORr(V(0));
                 }
                 if (m == 2)
                 {
-                    FORs(ADD(U(0), U(1)));
                     FORr(V(0) + V(1));
                 }
                 if (m == 3)
                 {
-                    FORs(ADD(U(0), U(1), U(2)));
                     FORr(V(0) + V(1) + V(2));
                 }
                 if (m >= 4)
                 {
-                    FORs(ADD(U(0), U(1), U(2), U(3)));
                     FORr(V(0) + V(1) + V(2) + V(3));
                 }
-#undef U
 #undef V
                 for (int x0 = 4; x0 < m; x0++)
                 {
@@ -256,7 +299,7 @@ void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r)
                     Af1 = (float*)A1;
                     wt1f = float(wt1);
                     y = 0;
-                    FORs(ADD(LD(Cf[y]), MUL(LDu(Af1[y]), SET(wt1f))));
+                    FORs(resampleAccumulate, Cf, Af1, wt1f, y, ha);
                     FORr(C[y] + A1[y] * wt1);
                 }
                 x1 += m;
@@ -271,7 +314,8 @@ void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r)
                 }
                 if (!xBd)
                 {
-                    FORs(ADD(MUL(LDu(Af0[y]), SET(wtf)), MUL(LDu(Af1[y]), SET(wt1f))));
+                    const float wts2[2] = { wtf, wt1f };
+                    FORs(resampleWeighted, Cf, Afs, wts2, 2, y, ha);
                 }
                 if (!xBd)
                 {
@@ -373,16 +417,34 @@ void resample(T* A, T* B, int ha, int hb, int wa, int wb, int d, T r)
             }
         }
     }
-    alFree(xas);
-    alFree(xbs);
-    alFree(xwts);
-    alFree(C);
-    alFree(yas);
-    alFree(ybs);
-    alFree(ywts);
 }
 
-void imResample(const MatP& A, MatP& B, const cv::Size& size, double nrm)
+std::shared_ptr<ImResampleCoef> createImResampleCoef(const cv::Size& sizeA, const cv::Size& sizeB)
+{
+    // Follow the (column major) axis convention of imResample():
+    auto coef = std::make_shared<ImResampleCoef>();
+    coef->ha = sizeA.width;
+    coef->wa = sizeA.height;
+    coef->hb = sizeB.width;
+    coef->wb = sizeB.height;
+
+    ScratchScope scratch;
+    int *as, *bs;
+    float* wts;
+    resampleCoef<float>(coef->wa, coef->wb, coef->wn, as, bs, wts, coef->xbd, 0);
+    coef->xas.assign(as, as + coef->wn);
+    coef->xbs.assign(bs, bs + coef->wn);
+    coef->xwts.assign(wts, wts + coef->wn);
+
+    resampleCoef<float>(coef->ha, coef->hb, coef->hn, as, bs, wts, coef->ybd, 4);
+    coef->yas.assign(as, as + coef->hn);
+    coef->ybs.assign(bs, bs + coef->hn);
+    coef->ywts.assign(wts, wts + coef->hn);
+
+    return coef;
+}
+
+void imResample(const MatP& A, MatP& B, const cv::Size& size, double nrm, const ImResampleCoef* coef)
 {
     B.create(size, A.depth(), A.channels());
 
@@ -390,10 +452,15 @@ void imResample(const MatP& A, MatP& B, const cv::Size& size, double nrm)
     std::swap(ha, wa);
     std::swap(hb, wb);
 
+    if (coef && !coef->matches(ha, hb, wa, wb))
+    {
+        coef = nullptr; // tables were built for another geometry
+    }
+
     switch (A.depth())
     {
         case CV_32F:
-            resample((float*)A.ptr(), reinterpret_cast<float*>(B.ptr()), ha, hb, wa, wb, d, float(nrm));
+            resample((float*)A.ptr(), reinterpret_cast<float*>(B.ptr()), ha, hb, wa, wb, d, float(nrm), coef);
             break;
         case CV_64F:
             resample((double*)A.ptr(), reinterpret_cast<double*>(B.ptr()), ha, hb, wa, wb, d, double(nrm));
@@ -406,7 +473,7 @@ void imResample(const MatP& A, MatP& B, const cv::Size& size, double nrm)
                 A[i].convertTo(A1[i], A1[i].type());
             }
 
-            resample(reinterpret_cast<float*>(A1.ptr()), reinterpret_cast<float*>(B1.ptr()), ha, hb, wa, wb, A.channels(), float(nrm));
+            resample(reinterpret_cast<float*>(A1.ptr()), reinterpret_cast<float*>(B1.ptr()), ha, hb, wa, wb, A.channels(), float(nrm), coef);
 
             for (int i = 0; i < B.channels(); i++)
             {
@@ -419,6 +486,12 @@ void imResample(const MatP& A, MatP& B, const cv::Size& size, double nrm)
     }
 }
 
+// resample raw column major float planes (ha x wa x d -> hb x wb x d), see imResample()
+void imResample(float* A, float* B, int ha, int hb, int wa, int wb, int d, float nrm)
+{
+    resample(A, B, ha, hb, wa, wb, d, nrm);
+}
+
 // B = imResampleMex(A,hb,wb,nrm); see imResample.m for usage details
 #ifdef MATLAB_MEX_FILE
 void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
@@ -0,0 +1,78 @@
+/*! -*-c++-*-
+  @file   rgbConvertKernels.hpp
+  @author David Hirvonen
+  @brief  Width generic rgb to luv block conversion for rgbConvertMex.cpp.
+
+  \copyright Copyright 2018 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  No include guard: compiled once per SIMD backend ACF_SIMD through simdDispatch.hpp (see
+  convConstKernels.hpp for the span convention).
+
+*/
+
+// J = R * mr + G * mg + B * mb
+template <typename V>
+inline int rgb2xyzSpan(const float* R, const float* G, const float* B, float* J, float mr, float mg, float mb, int i, int n)
+{
+    const typename V::F vR = V::set(mr), vG = V::set(mg), vB = V::set(mb);
+    for (; i + V::kWidth <= n; i += V::kWidth)
+    {
+        V::store(J + i, V::add(V::add(V::mul(V::load(R + i), vR), V::mul(V::load(G + i), vG)), V::mul(V::load(B + i), vB)));
+    }
+    return i;
+}
+
+// XZY -> LUV (without doing L lookup/normalization)
+template <typename V>
+inline int xyz2luvSpan(float* pX, float* pY, float* pZ, float un, float vn, int i, int n)
+{
+    const typename V::F c15 = V::set(15.0f), c3 = V::set(3.0f), cEps = V::set(1e-35f);
+    const typename V::F c52 = V::set(52.0f), c117 = V::set(117.0f), c1024 = V::set(1024.0f);
+    const typename V::F cun = V::set(13 * un), cvn = V::set(13 * vn);
+    for (; i + V::kWidth <= n; i += V::kWidth)
+    {
+        const typename V::F x = V::load(pX + i), y = V::load(pY + i);
+        const typename V::F z = V::rcp(V::add(x, V::add(cEps, V::add(V::mul(c15, y), V::mul(c3, V::load(pZ + i))))));
+        V::store(pX + i, V::mul(c1024, y));
+        V::store(pY + i, V::sub(V::mul(V::mul(c52, x), z), cun));
+        V::store(pZ + i, V::sub(V::mul(V::mul(c117, y), z), cvn));
+    }
+    return i;
+}
+
+// finalize computation of U and V
+template <typename V>
+inline int luvFinishSpan(const float* pL, float* pU, float* pV, float minu, float minv, int i, int n)
+{
+    const typename V::F cminu = V::set(minu), cminv = V::set(minv);
+    for (; i + V::kWidth <= n; i += V::kWidth)
+    {
+        const typename V::F l = V::load(pL + i);
+        V::store(pU + i, V::sub(V::mul(l, V::load(pU + i)), cminu));
+        V::store(pV + i, V::sub(V::mul(l, V::load(pV + i)), cminv));
+    }
+    return i;
+}
+
+// convert a block of m pixels (m % 4 == 0) from planar rgb floats to luv planes J, J + n, J + 2 * n
+inline void rgb2luvBlock(const float* R, const float* G, const float* B, float* J, int n, int m, const float* mr, const float* mg, const float* mb, float un, float vn, float minu, float minv, const float* lTable)
+{
+    // compute RGB -> XYZ
+    for (int j = 0; j < 3; j++)
+    {
+        float* Jj = J + j * n;
+        rgb2xyzSpan<Simd128>(R, G, B, Jj, mr[j], mg[j], mb[j], rgb2xyzSpan<ACF_SIMD>(R, G, B, Jj, mr[j], mg[j], mb[j], 0, m), m);
+    }
+
+    // compute XZY -> LUV (without doing L lookup/normalization)
+    float *pL = J, *pU = J + n, *pV = J + 2 * n;
+    xyz2luvSpan<Simd128>(pL, pU, pV, un, vn, xyz2luvSpan<ACF_SIMD>(pL, pU, pV, un, vn, 0, m), m);
+
+    // perform lookup for L and finalize computation of U and V
+    for (int i = 0; i < m; i++)
+    {
+        pL[i] = lTable[static_cast<int>(pL[i])];
+    }
+    luvFinishSpan<Simd128>(pL, pU, pV, minu, minv, luvFinishSpan<ACF_SIMD>(pL, pU, pV, minu, minv, 0, m), m);
+}
@@ -10,9 +10,13 @@
 #include <acf/toolbox/sse.hpp>
 
 #include <opencv2/core/mat.hpp>
+#include <opencv2/core/utility.hpp>
 
 #include <stddef.h>
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <typeinfo>
 
 // Constants for rgb2luv conversion and lookup table for y-> l conversion
@@ -83,7 +87,10 @@ void rgb2luv(iT* I, oT* J, int n, oT nrm)
     }
 }
 
-// Convert from rgb to luv using sse
+#define ACF_SIMD_KERNELS <acf/toolbox/rgbConvertKernels.hpp>
+#include <acf/toolbox/simdDispatch.hpp>
+
+// Convert from rgb to luv using sse/avx
 template <class iT>
 void rgb2luv_sse(iT* I, float* J, int n, float nrm)
 {
@@ -126,65 +133,7 @@ void rgb2luv_sse(iT* I, float* J, int n, float nrm)
             G1 = R1 + n;
             B1 = G1 + n;
         }
-        // compute RGB -> XYZ
-        for (int j = 0; j < 3; j++)
-        {
-            __m128 _mr, _mg, _mb, *_J = reinterpret_cast<__m128*>(J1 + j * n);
-            auto *_pR = reinterpret_cast<__m128*>(R1), *_pG = reinterpret_cast<__m128*>(G1), *_pB = reinterpret_cast<__m128*>(B1);
-            _mr = SET(mr[j]);
-            _mg = SET(mg[j]);
-            _mb = SET(mb[j]);
-            for (i1 = i; i1 < n1; i1 += 4)
-            {
-                *(_J++) = ADD(ADD(MUL(*(_pR++), _mr), MUL(*(_pG++), _mg)), MUL(*(_pB++), _mb));
-            }
-        }
-        {
-            // compute XZY -> LUV (without doing L lookup/normalization)
-            __m128 _c15, _c3, _cEps, _c52, _c117, _c1024, _cun, _cvn;
-            _c15 = SET(15.0f);
-            _c3 = SET(3.0f);
-            _cEps = SET(1e-35f);
-            _c52 = SET(52.0f);
-            _c117 = SET(117.0f), _c1024 = SET(1024.0f);
-            _cun = SET(13 * un);
-            _cvn = SET(13 * vn);
-            __m128 *_pX, *_pY, *_pZ, _x, _y, _z;
-            _pX = reinterpret_cast<__m128*>(J1);
-            _pY = reinterpret_cast<__m128*>(J1 + n);
-            _pZ = reinterpret_cast<__m128*>(J1 + 2 * n);
-            for (i1 = i; i1 < n1; i1 += 4)
-            {
-                _x = *_pX;
-                _y = *_pY;
-                _z = *_pZ;
-                _z = RCP(ADD(_x, ADD(_cEps, ADD(MUL(_c15, _y), MUL(_c3, _z)))));
-                *(_pX++) = MUL(_c1024, _y);
-                *(_pY++) = SUB(MUL(MUL(_c52, _x), _z), _cun);
-                *(_pZ++) = SUB(MUL(MUL(_c117, _y), _z), _cvn);
-            }
-        }
-        {
-            // perform lookup for L and finalize computation of U and V
-            for (i1 = i; i1 < n1; i1++)
-            {
-                J[i1] = lTable[static_cast<int>(J[i1])];
-            }
-            __m128 *_pL, *_pU, *_pV, _l, _cminu, _cminv;
-            _pL = reinterpret_cast<__m128*>(J1);
-            _pU = reinterpret_cast<__m128*>(J1 + n);
-            _pV = reinterpret_cast<__m128*>(J1 + 2 * n);
-            _cminu = SET(minu);
-            _cminv = SET(minv);
-            for (i1 = i; i1 < n1; i1 += 4)
-            {
-                _l = *(_pL++);
-                *_pU = SUB(MUL(_l, *_pU), _cminu);
-                _pU++;
-                *_pV = SUB(MUL(_l, *_pV), _cminv);
-                _pV++;
-            }
-        }
+        ACF_SIMD_DISPATCH(rgb2luvBlock, R1, G1, B1, J1, n, n1 - i, mr, mg, mb, un, vn, minu, minv, lTable);
         i = n1;
     }
 }
@@ -422,6 +371,102 @@ void rgbConvertMex(const MatP& I, MatP& J, int flag, double nrm)
     }
 }
 
+// Fused ingest of interleaved 8 bit color images (RGB, BGR, RGBA or BGRA): normalize to
+// [0,1] floats, split to planes, optionally transpose, and optionally convert to luv in a
+// single pass over the input.  The image is processed in small tiles that stay in L1, and
+// the per tile luv conversion uses the same kernels as rgbConvertMex() so the output is
+// identical to convertTo(1/255) + t() + MatP + rgbConvertMex(flag).
+// flag: {1,"rgb"} {2,"luv"}
+void rgbConvertInterleavedMex(const cv::Mat& I, MatP& J, int flag, bool isBGR, bool transpose)
+{
+    CV_Assert(I.depth() == CV_8U && (I.channels() == 3 || I.channels() == 4));
+    CV_Assert(flag == 1 || flag == 2);
+
+    const int cn = I.channels();
+    const int iR = isBGR ? 2 : 0, iG = 1, iB = isBGR ? 0 : 2;
+    const cv::Size size = transpose ? cv::Size(I.rows, I.cols) : I.size();
+    const float nrm = static_cast<float>(1.0 / 255.0); // see cvt8UC3To32FC3()
+
+    J.create(size, CV_32F, 3);
+
+    // Match the full image path, which uses sse iff the plane size is a multiple of 4:
+    const bool useSse = (size.area() % 4) == 0;
+    if (flag == 2)
+    {
+        float minu, minv, un, vn, mr[3], mg[3], mb[3];
+        rgb2luv_setup(1.f, mr, mg, mb, minu, minv, un, vn); // init lookup table before threading
+    }
+
+    const int k = 32; // tile size
+    const int nTileRows = (size.height + k - 1) / k;
+    cv::parallel_for_({ 0, nTileRows }, [&](const cv::Range& r) {
+        alignas(16) float rgb[3 * k * k], luv[3 * k * k];
+        for (int ty = r.start; ty < r.end; ty++)
+        {
+            const int y0 = ty * k, th = std::min(k, size.height - y0);
+            for (int x0 = 0; x0 < size.width; x0 += k)
+            {
+                const int tw = std::min(k, size.width - x0);
+                const int n = th * tw, n4 = (n + 3) & ~3;
+                float *R = rgb, *G = R + n4, *B = G + n4;
+
+                // Gather the tile, reading the input in row major order:
+                if (transpose)
+                {
+                    for (int x = 0; x < tw; x++)
+                    {
+                        const auto* p = I.ptr<uint8_t>(x0 + x) + y0 * cn;
+                        for (int y = 0; y < th; y++, p += cn)
+                        {
+                            R[y * tw + x] = float(p[iR]) * nrm;
+                            G[y * tw + x] = float(p[iG]) * nrm;
+                            B[y * tw + x] = float(p[iB]) * nrm;
+                        }
+                    }
+                }
+                else
+                {
+                    for (int y = 0; y < th; y++)
+                    {
+                        const auto* p = I.ptr<uint8_t>(y0 + y) + x0 * cn;
+                        for (int x = 0; x < tw; x++, p += cn)
+                        {
+                            R[y * tw + x] = float(p[iR]) * nrm;
+                            G[y * tw + x] = float(p[iG]) * nrm;
+                            B[y * tw + x] = float(p[iB]) * nrm;
+                        }
+                    }
+                }
+
+                const float* src = rgb;
+                if (flag == 2)
+                {
+                    std::fill(R + n, R + n4, 0.f);
+                    std::fill(G + n, G + n4, 0.f);
+                    std::fill(B + n, B + n4, 0.f);
+                    if (useSse)
+                    {
+                        rgb2luv_sse(rgb, luv, n4, 1.f);
+                    }
+                    else
+                    {
+                        rgb2luv(rgb, luv, n4, 1.f);
+                    }
+                    src = luv;
+                }
+
+                for (int c = 0; c < 3; c++)
+                {
+                    for (int y = 0; y < th; y++)
+                    {
+                        std::memcpy(J[c].ptr<float>(y0 + y) + x0, src + c * n4 + y * tw, sizeof(float) * tw);
+                    }
+                }
+            }
+        }
+    });
+}
+
 // J = rgbConvertMex(I,flag,single); see rgbConvert.m for usage details
 #ifdef MATLAB_MEX_FILE
 void mexFunction(int nl, mxArray* pl[], int nr, const mxArray* pr[])
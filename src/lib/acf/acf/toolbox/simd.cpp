@@ -0,0 +1,48 @@
+/*! -*-c++-*-
+  @file   simd.cpp
+  @author David Hirvonen
+  @brief  Runtime selection of the toolbox SIMD backend (see simd.hpp).
+
+  \copyright Copyright 2018 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include <acf/toolbox/simd.hpp>
+
+#include <opencv2/core/utility.hpp>
+
+#include <atomic>
+
+// Run time cap on the width (0 = none):
+static std::atomic<int> gSimdWidthLimit(0);
+
+int getSimdWidth()
+{
+    static const int width = []() {
+        int supported = 4;
+#if ACF_SIMD_X86
+        if (cv::checkHardwareSupport(CV_CPU_AVX_512F))
+        {
+            supported = 16;
+        }
+        else if (cv::checkHardwareSupport(CV_CPU_AVX2))
+        {
+            supported = 8;
+        }
+#endif
+#if defined(ACF_SIMD_WIDTH) && (ACF_SIMD_WIDTH > 0)
+        return (ACF_SIMD_WIDTH < supported) ? ACF_SIMD_WIDTH : supported;
+#else
+        return supported;
+#endif
+    }();
+
+    const int limit = gSimdWidthLimit.load(std::memory_order_relaxed);
+    return ((limit > 0) && (limit < width)) ? limit : width;
+}
+
+void setSimdWidth(int width)
+{
+    gSimdWidthLimit = width;
+}
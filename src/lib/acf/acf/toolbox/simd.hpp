@@ -0,0 +1,158 @@
+/*! -*-c++-*-
+  @file   simd.hpp
+  @author David Hirvonen
+  @brief  Width generic SIMD backends for the toolbox kernels with runtime dispatch.
+
+  \copyright Copyright 2018 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#ifndef __drishti_acf_toolbox_simd_hpp__
+#define __drishti_acf_toolbox_simd_hpp__
+
+#include <acf/toolbox/sse.hpp>
+
+// Each backend provides the same set of static operations on a vector type F of kWidth
+// floats (and a comparison mask type M), so a kernel is written once in terms of a backend
+// V and compiled for each of them (see simdDispatch.hpp).  Simd128 is built on sse.hpp and
+// so covers NEON as well; the 256 and 512 bit backends are x86 only (AVX2 and AVX-512F).
+// Loads and stores are unaligned.
+
+#if defined(__arm64) || defined(__ARM_NEON__) || defined(ANDROID)
+#  define ACF_SIMD_NEON 1
+#  define ACF_SIMD_X86 0
+#elif defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#  include <immintrin.h>
+#  define ACF_SIMD_NEON 0
+#  define ACF_SIMD_X86 1
+#  if defined(__GNUC__) || defined(__clang__)
+#    define ACF_SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#    define ACF_SIMD_TARGET_AVX512 __attribute__((target("avx512f")))
+#  else
+#    define ACF_SIMD_TARGET_AVX2
+#    define ACF_SIMD_TARGET_AVX512
+#  endif
+#else
+#  define ACF_SIMD_NEON 0
+#  define ACF_SIMD_X86 0
+#endif
+
+struct Simd128
+{
+#if ACF_SIMD_NEON
+    using F = float32x4_t;
+#else
+    using F = __m128;
+#endif
+    using M = F;
+    static const int kWidth = 4;
+
+    static F set(float x) { return SET(x); }
+    static F load(const float* p) { return LDu(*p); }
+    static void store(float* p, const F& x) { STRu(*p, x); }
+    static F add(const F& x, const F& y) { return ADD(x, y); }
+    static F sub(const F& x, const F& y) { return SUB(x, y); }
+    static F mul(const F& x, const F& y) { return MUL(x, y); }
+    static F min(const F& x, const F& y) { return MIN_sse(x, y); }
+    static F max(const F& x, const F& y) { return MAX_sse(x, y); }
+    static F rcp(const F& x) { return RCP(x); }
+    static F rcpsqrt(const F& x) { return RCPSQRT(x); }
+    static F bitAnd(const F& x, const F& y) { return AND(x, y); }
+    static F bitXor(const F& x, const F& y) { return XOR(x, y); }
+    static M greater(const F& x, const F& y) { return CMPGT(x, y); }
+    static F select(const M& m, const F& x, const F& y) { return OR(AND(m, x), ANDNOT(m, y)); }
+};
+
+#if ACF_SIMD_X86
+
+struct Simd256
+{
+    using F = __m256;
+    using M = __m256;
+    static const int kWidth = 8;
+
+    ACF_SIMD_TARGET_AVX2 static F set(float x) { return _mm256_set1_ps(x); }
+    ACF_SIMD_TARGET_AVX2 static F load(const float* p) { return _mm256_loadu_ps(p); }
+    ACF_SIMD_TARGET_AVX2 static void store(float* p, const F& x) { _mm256_storeu_ps(p, x); }
+    ACF_SIMD_TARGET_AVX2 static F add(const F& x, const F& y) { return _mm256_add_ps(x, y); }
+    ACF_SIMD_TARGET_AVX2 static F sub(const F& x, const F& y) { return _mm256_sub_ps(x, y); }
+    ACF_SIMD_TARGET_AVX2 static F mul(const F& x, const F& y) { return _mm256_mul_ps(x, y); }
+    ACF_SIMD_TARGET_AVX2 static F min(const F& x, const F& y) { return _mm256_min_ps(x, y); }
+    ACF_SIMD_TARGET_AVX2 static F max(const F& x, const F& y) { return _mm256_max_ps(x, y); }
+    ACF_SIMD_TARGET_AVX2 static F rcp(const F& x) { return _mm256_rcp_ps(x); }
+    ACF_SIMD_TARGET_AVX2 static F rcpsqrt(const F& x) { return _mm256_rsqrt_ps(x); }
+    ACF_SIMD_TARGET_AVX2 static F bitAnd(const F& x, const F& y) { return _mm256_and_ps(x, y); }
+    ACF_SIMD_TARGET_AVX2 static F bitXor(const F& x, const F& y) { return _mm256_xor_ps(x, y); }
+    ACF_SIMD_TARGET_AVX2 static M greater(const F& x, const F& y) { return _mm256_cmp_ps(x, y, _CMP_GT_OS); }
+    ACF_SIMD_TARGET_AVX2 static F select(const M& m, const F& x, const F& y) { return _mm256_blendv_ps(y, x, m); }
+};
+
+// AVX-512F only offers the 14 bit rcp/rsqrt approximations, so these are computed on
+// 256 bit halves instead, which keeps the results identical to the narrower backends.
+struct Simd512
+{
+    using F = __m512;
+    using M = __mmask16;
+    static const int kWidth = 16;
+
+    ACF_SIMD_TARGET_AVX512 static F set(float x) { return _mm512_set1_ps(x); }
+    ACF_SIMD_TARGET_AVX512 static F load(const float* p) { return _mm512_loadu_ps(p); }
+    ACF_SIMD_TARGET_AVX512 static void store(float* p, const F& x) { _mm512_storeu_ps(p, x); }
+    ACF_SIMD_TARGET_AVX512 static F add(const F& x, const F& y) { return _mm512_add_ps(x, y); }
+    ACF_SIMD_TARGET_AVX512 static F sub(const F& x, const F& y) { return _mm512_sub_ps(x, y); }
+    ACF_SIMD_TARGET_AVX512 static F mul(const F& x, const F& y) { return _mm512_mul_ps(x, y); }
+    ACF_SIMD_TARGET_AVX512 static F min(const F& x, const F& y) { return _mm512_min_ps(x, y); }
+    ACF_SIMD_TARGET_AVX512 static F max(const F& x, const F& y) { return _mm512_max_ps(x, y); }
+    ACF_SIMD_TARGET_AVX512 static F rcp(const F& x) { return join(_mm256_rcp_ps(low(x)), _mm256_rcp_ps(high(x))); }
+    ACF_SIMD_TARGET_AVX512 static F rcpsqrt(const F& x) { return join(_mm256_rsqrt_ps(low(x)), _mm256_rsqrt_ps(high(x))); }
+    ACF_SIMD_TARGET_AVX512 static F bitAnd(const F& x, const F& y)
+    {
+        return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(x), _mm512_castps_si512(y)));
+    }
+    ACF_SIMD_TARGET_AVX512 static F bitXor(const F& x, const F& y)
+    {
+        return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(x), _mm512_castps_si512(y)));
+    }
+    ACF_SIMD_TARGET_AVX512 static M greater(const F& x, const F& y) { return _mm512_cmp_ps_mask(x, y, _CMP_GT_OS); }
+    ACF_SIMD_TARGET_AVX512 static F select(const M& m, const F& x, const F& y) { return _mm512_mask_blend_ps(m, y, x); }
+
+private:
+    ACF_SIMD_TARGET_AVX512 static __m256 low(const F& x) { return _mm512_castps512_ps256(x); }
+    ACF_SIMD_TARGET_AVX512 static __m256 high(const F& x)
+    {
+        return _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(x), 1));
+    }
+    ACF_SIMD_TARGET_AVX512 static F join(const __m256& lo, const __m256& hi)
+    {
+        return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lo)), _mm256_castps_pd(hi), 1));
+    }
+};
+
+#endif // ACF_SIMD_X86
+
+// Widest vector (in floats) supported by this CPU, optionally capped at build time with
+// ACF_SIMD_WIDTH (e.g., -DACF_SIMD_WIDTH=4 forces the 128 bit path for testing) and at run
+// time with setSimdWidth() (0 restores the widest supported width), see simd.cpp:
+int getSimdWidth();
+void setSimdWidth(int width);
+
+// Call the variant of a kernel (see simdDispatch.hpp) for the widest supported backend:
+#if ACF_SIMD_X86
+#  define ACF_SIMD_DISPATCH(kernel, ...)  \
+    switch (getSimdWidth())               \
+    {                                     \
+        case 16:                          \
+            simd512::kernel(__VA_ARGS__); \
+            break;                        \
+        case 8:                           \
+            simd256::kernel(__VA_ARGS__); \
+            break;                        \
+        default:                          \
+            simd128::kernel(__VA_ARGS__); \
+    }
+#else
+#  define ACF_SIMD_DISPATCH(kernel, ...) simd128::kernel(__VA_ARGS__)
+#endif
+
+#endif // __drishti_acf_toolbox_simd_hpp__
@@ -0,0 +1,76 @@
+/*! -*-c++-*-
+  @file   simdDispatch.hpp
+  @author David Hirvonen
+  @brief  Compile a file of width generic kernels once per SIMD backend.
+
+  \copyright Copyright 2018 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Usage (no include guard, this file is meant to be included once per kernel file):
+
+  #define ACF_SIMD_KERNELS <acf/toolbox/fooKernels.hpp>
+  #include <acf/toolbox/simdDispatch.hpp>
+
+  The kernel file defines its kernels as plain functions in terms of the backend ACF_SIMD
+  (without an include guard or namespace) and is compiled into namespaces simd128, simd256
+  and simd512, with the wider variants built for AVX2 and AVX-512F respectively, so the
+  translation unit itself needs no -mavx style flags.  AVX-512F implies FMA, so it must be
+  built with floating point contraction off (-ffp-contract=off, see src/lib/CMakeLists.txt)
+  to keep all variants bit identical.  Call through ACF_SIMD_DISPATCH().
+
+*/
+
+#include <acf/toolbox/simd.hpp>
+
+#if !defined(ACF_SIMD_KERNELS)
+#  error "ACF_SIMD_KERNELS must name the kernel file to instantiate"
+#endif
+
+#define ACF_SIMD Simd128
+namespace simd128
+{
+#include ACF_SIMD_KERNELS
+} // namespace simd128
+#undef ACF_SIMD
+
+#if ACF_SIMD_X86
+
+#if defined(__clang__)
+#  pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#  pragma GCC push_options
+#  pragma GCC target("avx2")
+#endif
+
+#define ACF_SIMD Simd256
+namespace simd256
+{
+#include ACF_SIMD_KERNELS
+} // namespace simd256
+#undef ACF_SIMD
+
+#if defined(__clang__)
+#  pragma clang attribute pop
+#  pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#  pragma GCC pop_options
+#  pragma GCC push_options
+#  pragma GCC target("avx512f")
+#endif
+
+#define ACF_SIMD Simd512
+namespace simd512
+{
+#include ACF_SIMD_KERNELS
+} // namespace simd512
+#undef ACF_SIMD
+
+#if defined(__clang__)
+#  pragma clang attribute pop
+#elif defined(__GNUC__)
+#  pragma GCC pop_options
+#endif
+
+#endif // ACF_SIMD_X86
+
+#undef ACF_SIMD_KERNELS
@@ -1,5 +1,11 @@
 #include <acf/toolbox/wrappers.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
 // platform independent aligned memory allocation (see also alFree)
 void* alMalloc(size_t size, int alignment)
 {
@@ -16,3 +22,159 @@ void alFree(void* aligned)
     void* raw = *reinterpret_cast<void**>(reinterpret_cast<char*>(aligned) - sizeof(void*));
     wrFree(raw);
 }
+
+namespace
+{
+// One thread's scratch arena: blocks are filled in order and (block, offset) is the next free
+// byte.  Scopes save and restore the position, so releasing is just a rewind.
+struct ScratchArena
+{
+    struct Block
+    {
+        char* data;
+        size_t size;
+    };
+
+    ~ScratchArena()
+    {
+        release();
+    }
+
+    void* allocate(size_t size, int alignment)
+    {
+        const size_t a = alignment - 1;
+        for (;; block++, offset = 0)
+        {
+            if (block == blocks.size())
+            {
+                // grow geometrically so a thread settles after a few calls
+                const size_t n = std::max(std::max(size + a, capacity), kMinBlock);
+                blocks.push_back({ reinterpret_cast<char*>(wrMalloc(n)), n });
+                capacity += n;
+                count++;
+            }
+            const Block& b = blocks[block];
+            const size_t start = (((size_t)b.data + offset + a) & ~a) - (size_t)b.data;
+            if (start + size <= b.size)
+            {
+                used += start + size - offset;
+                offset = start + size;
+                highWater = std::max(highWater, used);
+                fill = std::max(fill, used);
+                notePeak(used);
+                return b.data + start;
+            }
+        }
+    }
+
+    // replace several blocks by one that holds the largest usage so far, when nothing is in use
+    void consolidate()
+    {
+        if (blocks.size() > 1)
+        {
+            const size_t n = std::max(fill, kMinBlock);
+            release();
+            blocks.push_back({ reinterpret_cast<char*>(wrMalloc(n)), n });
+            capacity = n;
+            count++;
+        }
+    }
+
+    void release()
+    {
+        for (auto& b : blocks)
+        {
+            wrFree(b.data);
+        }
+        blocks.clear();
+        capacity = 0;
+    }
+
+    static void notePeak(size_t value)
+    {
+        size_t current = peak.load(std::memory_order_relaxed);
+        while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    static constexpr size_t kMinBlock = 64 * 1024;
+    static std::atomic<size_t> peak;
+
+    std::vector<Block> blocks;
+    size_t block = 0, offset = 0, used = 0;
+    size_t highWater = 0, fill = 0, capacity = 0, count = 0;
+    int depth = 0;
+};
+
+constexpr size_t ScratchArena::kMinBlock;
+std::atomic<size_t> ScratchArena::peak(0);
+
+ScratchArena& getScratchArena()
+{
+    static thread_local ScratchArena arena;
+    return arena;
+}
+} // namespace
+
+ScratchScope::ScratchScope()
+{
+    auto& arena = getScratchArena();
+    block = arena.block;
+    offset = arena.offset;
+    used = arena.used;
+    arena.depth++;
+}
+
+ScratchScope::~ScratchScope()
+{
+    auto& arena = getScratchArena();
+    arena.block = block;
+    arena.offset = offset;
+    arena.used = used;
+    if (--arena.depth == 0)
+    {
+        arena.consolidate();
+    }
+}
+
+// aligned scratch memory valid until the innermost open ScratchScope closes
+void* alScratch(size_t size, int alignment)
+{
+    auto& arena = getScratchArena();
+    assert(arena.depth > 0); // nothing would ever release it
+    return arena.allocate(size, alignment);
+}
+
+// zero initialized alScratch()
+void* alScratchCalloc(size_t num, size_t size, int alignment)
+{
+    void* data = alScratch(num * size, alignment);
+    memset(data, 0, num * size);
+    return data;
+}
+
+// scratch arena usage of the calling thread
+ScratchStats alScratchStats()
+{
+    const auto& arena = getScratchArena();
+    ScratchStats stats;
+    stats.used = arena.used;
+    stats.highWater = arena.highWater;
+    stats.capacity = arena.capacity;
+    stats.blocks = arena.count;
+    return stats;
+}
+
+// peak of ScratchStats::used over all threads since the process started
+size_t alScratchPeak()
+{
+    return ScratchArena::peak.load();
+}
+
+// restart the high-water mark of the calling thread at its current usage
+void alScratchResetStats()
+{
+    auto& arena = getScratchArena();
+    arena.highWater = arena.used;
+}
@@ -7,6 +7,8 @@
 #ifndef __drishti_acf_toolbox_wrappers_hpp__
 #define __drishti_acf_toolbox_wrappers_hpp__
 
+#include <cstddef>
+
 #ifdef MATLAB_MEX_FILE
 
 // wrapper functions if compiling from Matlab
@@ -57,4 +59,46 @@ void* alMalloc(size_t size, int alignment);
 // platform independent alignned memory de-allocation (see also alMalloc)
 void alFree(void* aligned);
 
+// Scratch memory for the toolbox kernels: each thread has a bump arena whose blocks are
+// kept for the lifetime of the thread, so per call temporaries don't go through malloc.
+// Allocations belong to the innermost open ScratchScope and are all released when it
+// closes, so scopes must nest (plain RAII locals do).  When the outermost scope closes,
+// an arena that had to grow is consolidated into a single block.
+class ScratchScope
+{
+public:
+    ScratchScope();
+    ~ScratchScope();
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+protected:
+    size_t block, offset, used;
+};
+
+// Scratch arena usage of the calling thread (see alScratchStats)
+struct ScratchStats
+{
+    size_t used = 0;      // bytes held by open scopes
+    size_t highWater = 0; // peak of used since the thread started or alScratchResetStats()
+    size_t capacity = 0;  // bytes in the arena blocks
+    size_t blocks = 0;    // arena blocks allocated (each one is a malloc call)
+};
+
+// aligned scratch memory valid until the innermost open ScratchScope closes
+void* alScratch(size_t size, int alignment);
+
+// zero initialized alScratch()
+void* alScratchCalloc(size_t num, size_t size, int alignment);
+
+// scratch arena usage of the calling thread
+ScratchStats alScratchStats();
+
+// peak of ScratchStats::used over all threads since the process started
+size_t alScratchPeak();
+
+// restart the high-water mark of the calling thread at its current usage
+void alScratchResetStats();
+
 #endif
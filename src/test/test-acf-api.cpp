@@ -62,6 +62,7 @@ int gauze_main(int argc, char** argv)
 #include <acf/ACF.h>
 #include <acf/MatP.h>
 #include <acf/convert.h> // private
+#include <acf/toolbox/wrappers.hpp> // private
 #include <io/cereal_pba.h> // private
 #include <common/Logger.h> 
 
@@ -88,8 +89,11 @@ static const auto gVersion = aglet::GLContext::kGL;
 #endif // defined(ACF_DO_GPU)
 // clang-format on
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <fstream>
+#include <iostream>
 #include <memory>
 
 namespace spdlog {
@@ -114,6 +118,7 @@ BEGIN_EMPTY_NAMESPACE
 // http://stackoverflow.com/a/32647694
 static bool isEqual(const cv::Mat& a, const cv::Mat& b);
 static bool isEqual(const acf::Detector& a, const acf::Detector& b);
+static double overlap(const cv::Rect& a, const cv::Rect& b); // intersection over union
 
 class ACFTest : public ::testing::Test
 {
@@ -238,6 +243,45 @@ protected:
         }
     }
 
+    // The uint8 pyramid (see setDoUint8()) should find (nearly) all of the float detections:
+    void testPedestrianDetectorUint8(const char* detectorFilename, const char* inputFilename)
+    {
+        if (detectorFilename && inputFilename)
+        {
+            auto detector = create(detectorFilename);
+            ASSERT_NE(detector, nullptr);
+
+            cv::Mat image = cv::imread(inputFilename);
+            ASSERT_FALSE(image.empty());
+
+            std::vector<double> scores, scoresU8;
+            std::vector<cv::Rect> objects, objectsU8;
+            detector->setIsTranspose(false);
+            detector->setDoNonMaximaSuppression(true);
+            (*detector)(image, objects, &scores);
+
+            detector->setDoUint8(true);
+            (*detector)(image, objectsU8, &scoresU8);
+
+            acf::Detector::Pyramid P;
+            detector->computePyramid(image, P);
+            detector->setDoUint8(false);
+
+            ASSERT_GT(P.nScales, 0);
+            ASSERT_EQ(P.data[0][0].depth(), CV_8U);
+
+            ASSERT_GE(objects.size(), 5);
+            std::size_t found = 0;
+            for (const auto& object : objects)
+            {
+                found += std::any_of(objectsU8.begin(), objectsU8.end(), [&](const cv::Rect& roi) {
+                    return overlap(roi, object) > 0.5;
+                });
+            }
+            ASSERT_GE(found * 10, objects.size() * 9);
+        }
+    }
+
 #if defined(ACF_DO_GPU)
     static std::vector<ogles_gpgpu::Size2d> getPyramidSizes(acf::Detector::Pyramid& Pcpu)
     {
@@ -413,6 +457,68 @@ TEST_F(ACFTest, ACFchnsComputeRgbToLuv)
     rgbToX(imageFilename, "luv");
 }
 
+TEST_F(ACFTest, ACFchnsComputeFused)
+{
+    acf::Detector::Channels dflt, fused, staged;
+    acf::Detector::chnsCompute({}, {}, dflt, true, {});
+
+    cv::Mat image = cv::imread(imageFilename);
+    ASSERT_FALSE(image.empty());
+    cv::cvtColor(image, image, cv::COLOR_BGR2RGB);
+    image = image(cv::Rect(0, 0, (image.cols / 4) * 4, (image.rows / 4) * 4)); // no crop in chnsCompute()
+    image.convertTo(image, CV_32FC3, 1.0 / 255.0);
+
+    MatP I(image);
+    auto pChns = dflt.pChns;
+    pChns.doFused = true;
+    acf::Detector::chnsCompute(I, pChns, fused, false, {});
+    pChns.doFused = false;
+    acf::Detector::chnsCompute(I, pChns, staged, false, {});
+
+    // The banded computation must be bit-exact with the separate stages:
+    ASSERT_EQ(fused.data.size(), staged.data.size());
+    for (int i = 0; i < staged.data.size(); i++)
+    {
+        ASSERT_EQ(fused.info[i].name, staged.info[i].name);
+        ASSERT_EQ(fused.data[i].channels(), staged.data[i].channels());
+        for (int j = 0; j < staged.data[i].channels(); j++)
+        {
+            ASSERT_TRUE(isEqual(fused.data[i][j], staged.data[i][j]));
+        }
+    }
+}
+
+TEST_F(ACFTest, ACFchnsComputeScratch)
+{
+    acf::Detector::Channels dflt, channels;
+    acf::Detector::chnsCompute({}, {}, dflt, true, {});
+
+    MatP I(m_I);
+    acf::Detector::chnsCompute(I, dflt.pChns, channels, false, {});
+    const auto warm = alScratchStats();
+    std::vector<const uchar*> planes;
+    for (const auto& c : channels.data)
+    {
+        planes.push_back(c.base().data);
+    }
+
+    // Repeated calls reuse the scratch arena of this thread without growing it:
+    acf::Detector::chnsCompute(I, dflt.pChns, channels, false, {});
+    const auto stats = alScratchStats();
+    ASSERT_EQ(stats.used, 0u);
+    ASSERT_GT(stats.highWater, 0u);
+    ASSERT_EQ(stats.blocks, warm.blocks);
+    ASSERT_GE(alScratchPeak(), stats.highWater);
+
+    // ... and write the channels into the planes of the previous call:
+    ASSERT_GT(planes.size(), 0);
+    ASSERT_EQ(channels.data.size(), planes.size());
+    for (int i = 0; i < planes.size(); i++)
+    {
+        ASSERT_EQ(channels.data[i].base().data, planes[i]);
+    }
+}
+
 /*
 `>> result = chnsPyramid`
 ```
@@ -549,6 +655,620 @@ TEST_F(ACFTest, ACFPyramidCPU)
     ASSERT_GT(pyramid->data.max_size(), 0);
 }
 
+// The fused 8 bit BGR ingest should match the float RGB reference path:
+TEST_F(ACFTest, ACFPyramidCPUIngest)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    acf::Detector::Pyramid Pref, P;
+    detector->setIsTranspose(true);
+    detector->computePyramid(m_IpT, Pref);
+
+    detector->setIsTranspose(false);
+    detector->setIsBGR(true);
+    detector->computePyramid(cv::imread(imageFilename, cv::IMREAD_COLOR), P);
+    detector->setIsBGR(false);
+
+    ASSERT_EQ(P.nScales, Pref.nScales);
+    for (int i = 0; i < P.nScales; i++)
+    {
+        ASSERT_EQ(P.data[i][0].size(), Pref.data[i][0].size());
+        ASSERT_LE(cv::norm(P.data[i][0].base(), Pref.data[i][0].base(), cv::NORM_INF), 1e-5);
+    }
+}
+
+// Repeated detection at a fixed resolution should reuse all pyramid storage, including the
+// channels computed at the real scales:
+TEST_F(ACFTest, ACFPyramidWorkspace)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    std::vector<double> scores;
+    std::vector<cv::Rect> objects;
+    detector->setIsTranspose(true);
+    (*detector)(m_IpT, objects, &scores);
+    ASSERT_GT(detector->getPyramidWorkspace().allocations, 0);
+
+    for (int i = 0; i < 2; i++)
+    {
+        objects.clear();
+        (*detector)(m_IpT, objects, &scores);
+        ASSERT_EQ(detector->getPyramidWorkspace().allocations, 0);
+    }
+}
+
+// The pyramid plan is built once per input size and replayed exactly on later frames:
+TEST_F(ACFTest, ACFPyramidPlan)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    acf::Detector::Pyramid P0, P1;
+    detector->setIsTranspose(true);
+    detector->computePyramid(m_IpT, P0);
+    ASSERT_EQ(detector->getPyramidWorkspace().plans, 1);
+
+    detector->computePyramid(m_IpT, P1);
+    ASSERT_EQ(detector->getPyramidWorkspace().plans, 0);
+
+    const auto& plan = detector->getPyramidWorkspace().plan;
+    ASSERT_EQ(plan.scales, P1.scales);
+    ASSERT_EQ(P0.nScales, P1.nScales);
+    for (int i = 0; i < P1.nScales; i++)
+    {
+        ASSERT_EQ(P1.data[i][0].size(), plan.paddedSizes[i]);
+        ASSERT_EQ(cv::norm(P0.data[i][0].base(), P1.data[i][0].base(), cv::NORM_INF), 0.0);
+    }
+}
+
+// Levels kept for an object size range should match the full pyramid exactly:
+TEST_F(ACFTest, ACFPyramidObjectSize)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    acf::Detector::Pyramid P, Pbounded;
+    detector->setIsTranspose(true);
+    detector->computePyramid(m_IpT, P);
+
+    const cv::Size modelDs = detector->opts.modelDs.get();
+    const int minWidth = modelDs.height, maxWidth = modelDs.height * 2;
+    detector->setMinObjectSize({ minWidth, 0 });
+    detector->setMaxObjectSize({ maxWidth, 0 });
+    detector->computePyramid(m_IpT, Pbounded);
+
+    ASSERT_GT(Pbounded.nScales, 0);
+    ASSERT_LT(Pbounded.nScales, P.nScales);
+    for (int i = 0; i < Pbounded.nScales; i++)
+    {
+        const auto iter = std::find(P.scales.begin(), P.scales.end(), Pbounded.scales[i]);
+        ASSERT_NE(iter, P.scales.end());
+        const auto j = std::distance(P.scales.begin(), iter);
+        ASSERT_EQ(cv::norm(P.data[j][0].base(), Pbounded.data[i][0].base(), cv::NORM_INF), 0.0);
+    }
+
+    std::vector<double> scores;
+    std::vector<cv::Rect> objects;
+    (*detector)(m_IpT, objects, &scores);
+    for (const auto& object : objects)
+    {
+        ASSERT_GE(object.width, minWidth);
+        ASSERT_LE(object.width, maxWidth);
+    }
+
+    detector->setMinObjectSize({});
+    detector->setMaxObjectSize({});
+}
+
+// Concurrent real scale computation should match a single threaded run exactly:
+TEST_F(ACFTest, ACFPyramidParallel)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    acf::Detector::Pyramid Pserial, Pparallel;
+    detector->setIsTranspose(true);
+
+    const int nThreads = cv::getNumThreads();
+    cv::setNumThreads(1);
+    detector->computePyramid(m_IpT, Pserial);
+    cv::setNumThreads(nThreads);
+    detector->computePyramid(m_IpT, Pparallel);
+
+    ASSERT_EQ(Pserial.nScales, Pparallel.nScales);
+    ASSERT_EQ(Pserial.lambdas, Pparallel.lambdas);
+    for (int i = 0; i < Pserial.nScales; i++)
+    {
+        ASSERT_EQ(cv::norm(Pserial.data[i][0].base(), Pparallel.data[i][0].base(), cv::NORM_INF), 0.0);
+    }
+}
+
+// The 128, 256 and 512 bit toolbox kernels should compute identical pyramids (widths this
+// CPU does not support fall back to the widest supported one):
+TEST_F(ACFTest, ACFPyramidSimdWidths)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    const int widths[] = { 4, 8, 16 };
+    acf::Detector::Pyramid P[3];
+    detector->setIsTranspose(true);
+    for (int i = 0; i < 3; i++)
+    {
+        acf::Detector::setSimdWidth(widths[i]);
+        detector->computePyramid(m_IpT, P[i]);
+    }
+    acf::Detector::setSimdWidth(0);
+
+    for (int i = 1; i < 3; i++)
+    {
+        ASSERT_EQ(P[i].nScales, P[0].nScales);
+        for (int j = 0; j < P[0].nScales; j++)
+        {
+            ASSERT_EQ(cv::norm(P[i].data[j][0].base(), P[0].data[j][0].base(), cv::NORM_INF), 0.0) << "width " << widths[i];
+        }
+    }
+}
+
+// Streaming detection (one group of levels at a time) should match full pyramid detection:
+TEST_F(ACFTest, ACFDetectionStreaming)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    std::vector<double> scores, streamScores;
+    std::vector<cv::Rect> objects, streamObjects;
+    detector->setIsTranspose(true);
+    (*detector)(m_IpT, objects, &scores);
+
+    detector->setDoStreaming(true);
+    (*detector)(m_IpT, streamObjects, &streamScores);
+    detector->setDoStreaming(false);
+
+    ASSERT_EQ(objects, streamObjects);
+    ASSERT_EQ(scores, streamScores);
+}
+
+// Scheduled pyramid and scan stages report one timing record per task:
+TEST_F(ACFTest, ACFSchedulerTimings)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    std::vector<double> scores;
+    std::vector<cv::Rect> objects;
+    detector->setIsTranspose(true);
+    (*detector)(m_IpT, objects, &scores);
+
+    const auto& pyramidTimings = detector->getPyramidWorkspace().timings;
+    ASSERT_GT(pyramidTimings.size(), 0);
+    for (const auto& timing : pyramidTimings)
+    {
+        ASSERT_NE(timing.stage, nullptr);
+        ASSERT_GE(timing.seconds, 0.0);
+    }
+
+    int task = 0;
+    for (const auto& timing : detector->getDetectionTimings())
+    {
+        ASSERT_LT(timing.worker, std::max(cv::getNumThreads(), 1));
+        if (std::string(timing.stage) == "scan")
+        {
+            ASSERT_EQ(timing.task, task++);
+            ASSERT_GT(timing.cost, 0.0);
+        }
+    }
+    ASSERT_GT(task, 0);
+}
+
+// A region around a full frame detection should find it again, and only windows with
+// centers in the region are reported:
+TEST_F(ACFTest, ACFDetectionRegions)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    std::vector<double> scores;
+    std::vector<cv::Rect> objects;
+    detector->setIsTranspose(false);
+    detector->setDoNonMaximaSuppression(true);
+    (*detector)(m_I, objects, &scores);
+    ASSERT_GT(objects.size(), 0);
+
+    const auto& object = objects.front();
+    const cv::Rect roi(object.x - object.width / 2, object.y - object.height / 2, object.width * 2, object.height * 2);
+    const acf::Detector::SearchRegion region(roi, object.width * 0.5, object.width * 2.0);
+
+    std::vector<double> regionScores;
+    std::vector<cv::Rect> regionObjects;
+    (*detector)(m_I, { region }, regionObjects, &regionScores);
+    ASSERT_GT(regionObjects.size(), 0);
+    ASSERT_GT(overlap(regionObjects.front(), object), 0.5);
+
+    detector->setDoNonMaximaSuppression(false);
+    regionObjects.clear();
+    (*detector)(m_I, { region }, regionObjects, &regionScores);
+    const cv::Rect tolerance(roi.x - 1, roi.y - 1, roi.width + 2, roi.height + 2); // rounding
+    for (const auto& bb : regionObjects)
+    {
+        ASSERT_TRUE(tolerance.contains({ bb.x + bb.width / 2, bb.y + bb.height / 2 }));
+        ASSERT_GE(bb.width, region.minWidth);
+        ASSERT_LE(bb.width, region.maxWidth);
+    }
+
+    // Overlapping halves of the region share one covering tile, so they report the same
+    // windows (once) as the whole region:
+    const int half = roi.width / 2;
+    const acf::Detector::SearchRegion left({ roi.x, roi.y, half, roi.height }, region.minWidth, region.maxWidth);
+    const acf::Detector::SearchRegion right({ roi.x + half, roi.y, roi.width - half, roi.height }, region.minWidth, region.maxWidth);
+    std::vector<double> splitScores;
+    std::vector<cv::Rect> splitObjects;
+    (*detector)(m_I, { left, right }, splitObjects, &splitScores);
+    ASSERT_EQ(splitObjects.size(), regionObjects.size());
+    for (const auto& bb : splitObjects)
+    {
+        double best = 0.0;
+        for (const auto& bb1 : regionObjects)
+        {
+            best = std::max(best, overlap(bb, bb1));
+        }
+        ASSERT_GT(best, 0.9);
+    }
+}
+
+// With a zero margin a bounded scan returns exactly the best raw detections:
+TEST_F(ACFTest, ACFDetectionBounded)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    std::vector<double> scores, boundedScores;
+    std::vector<cv::Rect> objects, boundedObjects;
+    detector->setIsTranspose(true);
+    (*detector)(m_IpT, objects, &scores);
+
+    const std::size_t count = 20;
+    ASSERT_GT(scores.size(), count);
+
+    detector->setMaxCandidateCount(count);
+    (*detector)(m_IpT, boundedObjects, &boundedScores);
+    detector->setMaxCandidateCount(0);
+
+    std::sort(scores.begin(), scores.end(), std::greater<double>());
+    std::sort(boundedScores.begin(), boundedScores.end(), std::greater<double>());
+    scores.resize(count);
+    ASSERT_EQ(scores, boundedScores);
+}
+
+// Per level nms before the global nms should find the same objects:
+TEST_F(ACFTest, ACFDetectionLocalNms)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    std::vector<double> scores, localScores;
+    std::vector<cv::Rect> objects, localObjects;
+    detector->setIsTranspose(true);
+    detector->setDoNonMaximaSuppression(true);
+    (*detector)(m_IpT, objects, &scores);
+
+    detector->setDoLocalNms(true);
+    (*detector)(m_IpT, localObjects, &localScores);
+    detector->setDoLocalNms(false);
+    detector->setDoNonMaximaSuppression(false);
+
+    ASSERT_GT(localObjects.size(), 0);
+    for (const auto& object : objects)
+    {
+        ASSERT_TRUE(std::any_of(localObjects.begin(), localObjects.end(), [&](const cv::Rect& roi) {
+            return overlap(roi, object) > 0.5;
+        }));
+    }
+}
+
+// The coarse to fine scan should find the same objects with fewer windows:
+TEST_F(ACFTest, ACFDetectionCoarseToFine)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    std::vector<double> scores, coarseScores;
+    std::vector<cv::Rect> objects, coarseObjects;
+    detector->setIsTranspose(true);
+    detector->setDoNonMaximaSuppression(true);
+    (*detector)(m_IpT, objects, &scores);
+    const auto windows = detector->getEvaluatedWindowCount();
+
+    detector->setDoCoarseToFine(true);
+    (*detector)(m_IpT, coarseObjects, &coarseScores);
+    const auto coarseWindows = detector->getEvaluatedWindowCount();
+    detector->setDoCoarseToFine(false);
+    detector->setDoNonMaximaSuppression(false);
+
+    ASSERT_GT(windows, 0);
+    ASSERT_LT(coarseWindows * 2, windows);
+    ASSERT_GT(coarseObjects.size(), 0);
+    for (const auto& object : objects)
+    {
+        ASSERT_TRUE(std::any_of(coarseObjects.begin(), coarseObjects.end(), [&](const cv::Rect& roi) {
+            return overlap(roi, object) > 0.5;
+        }));
+    }
+}
+
+// The half precision pyramid should find the same objects as the float pyramid:
+TEST_F(ACFTest, ACFDetectionHalf)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    std::vector<double> scores, halfScores;
+    std::vector<cv::Rect> objects, halfObjects;
+    detector->setIsTranspose(true);
+    detector->setDoNonMaximaSuppression(true);
+    (*detector)(m_IpT, objects, &scores);
+
+    detector->setDoHalf(true);
+    (*detector)(m_IpT, halfObjects, &halfScores);
+
+    acf::Detector::Pyramid P;
+    detector->computePyramid(m_IpT, P);
+    detector->setDoHalf(false);
+    detector->setDoNonMaximaSuppression(false);
+
+    ASSERT_GT(P.nScales, 0);
+    ASSERT_EQ(P.data[0][0].depth(), CV_16F);
+
+    ASSERT_GT(objects.size(), 0);
+    for (const auto& object : objects)
+    {
+        ASSERT_TRUE(std::any_of(halfObjects.begin(), halfObjects.end(), [&](const cv::Rect& roi) {
+            return overlap(roi, object) > 0.5;
+        }));
+    }
+}
+
+// A time budget should report the skipped scales, and complete the search if it is ample:
+TEST_F(ACFTest, ACFDetectionTimeBudget)
+{
+    auto detector = getDetector();
+    ASSERT_NE(detector, nullptr);
+
+    std::vector<double> scores, timedScores;
+    std::vector<cv::Rect> objects, timedObjects, expiredObjects;
+    detector->setIsTranspose(true);
+    (*detector)(m_IpT, objects, &scores);
+
+    detector->setTimeBudget(60.0);
+    (*detector)(m_IpT, timedObjects, &timedScores);
+    ASSERT_TRUE(detector->getSkippedScales().empty());
+
+    detector->setTimeBudget(1e-9);
+    (*detector)(m_IpT, expiredObjects);
+    detector->setTimeBudget(0.0);
+    ASSERT_GT(detector->getSkippedScales().size(), 0);
+    ASSERT_TRUE(expiredObjects.empty());
+
+    std::sort(scores.begin(), scores.end());
+    std::sort(timedScores.begin(), timedScores.end());
+    ASSERT_EQ(scores, timedScores);
+}
+
+// Synthetic raw detections: nObjects x nObjects objects on a grid, each with a cluster of
+// nPerObject windows jittered in position and scale and scored by proximity to the object.
+static acf::Detector::DetectionVec createCandidates(int nObjects, int nPerObject, std::vector<cv::Rect>& objects)
+{
+    cv::RNG rng(1);
+    acf::Detector::DetectionVec bbs;
+    for (int y = 0; y < nObjects; y++)
+    {
+        for (int x = 0; x < nObjects; x++)
+        {
+            const int w = rng.uniform(32, 96), h = w * 2;
+            objects.emplace_back(x * 256 + rng.uniform(0, 64), y * 384 + rng.uniform(0, 64), w, h);
+            for (int i = 0; i < nPerObject; i++)
+            {
+                const double dx = rng.uniform(-0.1, 0.1), dy = rng.uniform(-0.1, 0.1), ds = rng.uniform(-0.25, 0.25);
+                const cv::Size size(cvRound(w * std::pow(2.0, ds)), cvRound(h * std::pow(2.0, ds)));
+                const cv::Point center(cvRound(objects.back().x + w * (0.5 + dx)), cvRound(objects.back().y + h * (0.5 + dy)));
+                const double score = 1.0 - std::abs(dx) - std::abs(dy) - std::abs(ds) + rng.uniform(0.0, 0.1);
+                bbs.emplace_back(cv::Rect(center - cv::Point(size.width / 2, size.height / 2), size), score);
+            }
+        }
+    }
+    return bbs;
+}
+
+TEST(ACFNmsTest, MeanShift)
+{
+    acf::Detector detector;
+    acf::Detector::Options::Nms pNms;
+    pNms.type = { "type", std::string("ms") };
+
+    // Two nearly coincident boxes merge into a single mode, the distant box is kept:
+    acf::Detector::DetectionVec bbs, bbsIn{ { { 0, 0, 10, 10 }, 1.0 }, { { 1, 1, 10, 10 }, 1.1 }, { { 40, 40, 10, 10 }, 1.0 } };
+    detector.bbNms(bbsIn, pNms, bbs);
+    ASSERT_EQ(bbs.size(), 2);
+    ASSERT_GT(overlap(bbs[0].roi, bbsIn[1].roi), 0.5);
+    ASSERT_EQ(bbs[1].roi, bbsIn[2].roi);
+
+    // Boxes at or below thr are discarded:
+    pNms.thr = { "thr", 1.05 };
+    detector.bbNms(bbsIn, pNms, bbs);
+    ASSERT_EQ(bbs.size(), 1);
+    ASSERT_EQ(bbs[0].roi, bbsIn[1].roi);
+}
+
+TEST(ACFNmsTest, Cover)
+{
+    acf::Detector detector;
+    acf::Detector::Options::Nms pNms;
+    pNms.type = { "type", std::string("cover") };
+
+    // The chosen bb takes the summed score of the bbs it covers:
+    acf::Detector::DetectionVec bbs, bbsIn{ { { 0, 0, 10, 10 }, 1.0 }, { { 1, 1, 10, 10 }, 1.1 }, { { 40, 40, 10, 10 }, 1.0 } };
+    detector.bbNms(bbsIn, pNms, bbs);
+    ASSERT_EQ(bbs.size(), 2);
+    ASSERT_NEAR(bbs[0].score, 2.1, 1e-6);
+    ASSERT_EQ(bbs[1].roi, bbsIn[2].roi);
+    ASSERT_EQ(bbs[1].score, 1.0);
+
+    // A covered bb is never picked, even if it overlaps uncovered bbs: bb 2 (next to the heavy
+    // bb 3) covers bbs 1 to 3, which leaves 0 and 4 (both overlapping 1 but not each other):
+    bbsIn = { { { 0, 2, 10, 10 }, 1.0 }, { { 2, 2, 10, 10 }, 1.0 }, { { 4, 2, 10, 10 }, 1.0 }, { { 6, 2, 10, 10 }, 10.0 }, { { 2, 0, 10, 10 }, 1.0 } };
+    detector.bbNms(bbsIn, pNms, bbs);
+    ASSERT_EQ(bbs.size(), 3);
+    ASSERT_EQ(bbs[0].roi, bbsIn[2].roi);
+    ASSERT_NEAR(bbs[0].score, 12.0, 1e-6);
+    for (const auto& i : { 0, 4 })
+    {
+        ASSERT_TRUE(std::any_of(bbs.begin() + 1, bbs.end(), [&](const acf::Detector::Detection& bb) {
+            return (bb.roi == bbsIn[i].roi) && (bb.score == 1.0);
+        }));
+    }
+}
+
+TEST(ACFNmsTest, Soft)
+{
+    acf::Detector detector;
+    acf::Detector::Options::Nms pNms;
+    pNms.thr = { "thr", 0.0 };
+
+    // Overlapping bbs decay (by 1-o or exp(-o^2/0.5)) instead of being suppressed:
+    const double o = 81.0 / 119.0;
+    acf::Detector::DetectionVec bbs, bbsIn{ { { 0, 0, 10, 10 }, 1.0 }, { { 1, 1, 10, 10 }, 1.1 }, { { 40, 40, 10, 10 }, 1.0 } };
+    for (const auto& type : { "soft", "softg" })
+    {
+        pNms.type = { "type", std::string(type) };
+        detector.bbNms(bbsIn, pNms, bbs);
+        ASSERT_EQ(bbs.size(), 3);
+        ASSERT_EQ(bbs[0].roi, bbsIn[1].roi);
+        ASSERT_EQ(bbs[0].score, 1.1);
+        ASSERT_EQ(bbs[1].roi, bbsIn[2].roi);
+        ASSERT_EQ(bbs[2].roi, bbsIn[0].roi);
+        ASSERT_NEAR(bbs[2].score, (type == std::string("soft")) ? (1.0 - o) : std::exp(-o * o / 0.5), 1e-6);
+    }
+
+    // Scores decay toward thr, and bbs that decay to thr (an exact duplicate) are dropped:
+    pNms.type = { "type", std::string("soft") };
+    pNms.thr = { "thr", 0.5 };
+    auto bbsDup = bbsIn;
+    bbsDup.emplace_back(bbsIn[1].roi, 1.0);
+    detector.bbNms(bbsDup, pNms, bbs);
+    ASSERT_EQ(bbs.size(), 3);
+    ASSERT_EQ(bbs[2].roi, bbsIn[0].roi);
+    ASSERT_NEAR(bbs[2].score, 0.5 + 0.5 * (1.0 - o), 1e-6);
+}
+
+// Negative scores (as seen with cascThr = -1) decay toward thr, which defaults to cascThr:
+TEST(ACFNmsTest, SoftNegative)
+{
+    acf::Detector detector;
+    detector.opts.cascThr = { "cascThr", -1.0 };
+    acf::Detector::Options::Nms pNms;
+    pNms.type = { "type", std::string("soft") };
+
+    const double o = 81.0 / 119.0;
+    acf::Detector::DetectionVec bbs, bbsIn{ { { 0, 0, 10, 10 }, -0.5 }, { { 1, 1, 10, 10 }, -0.4 }, { { 40, 40, 10, 10 }, -0.5 } };
+    detector.bbNms(bbsIn, pNms, bbs);
+    ASSERT_EQ(bbs.size(), 3);
+    ASSERT_EQ(bbs[0].roi, bbsIn[1].roi);
+    ASSERT_EQ(bbs[1].roi, bbsIn[2].roi);
+    ASSERT_EQ(bbs[1].score, -0.5);
+    ASSERT_EQ(bbs[2].roi, bbsIn[0].roi);
+    ASSERT_LT(bbs[2].score, bbsIn[0].score);
+    ASSERT_NEAR(bbs[2].score, -1.0 + 0.5 * (1.0 - o), 1e-6);
+}
+
+// The sweep line 'maxg' should match the all pairs greedy reference exactly:
+TEST(ACFNmsTest, MaxGreedy)
+{
+    std::vector<cv::Rect> objects;
+    auto candidates = createCandidates(4, 50, objects);
+
+    acf::Detector detector;
+    acf::Detector::Options::Nms pNms;
+    pNms.type = { "type", std::string("maxg") };
+
+    acf::Detector::DetectionVec bbs;
+    detector.bbNms(candidates, pNms, bbs);
+
+    std::sort(candidates.begin(), candidates.end(), [](const acf::Detector::Detection& a, const acf::Detector::Detection& b) {
+        return a.score > b.score;
+    });
+    acf::Detector::DetectionVec truth;
+    for (const auto& bb : candidates)
+    {
+        if (std::none_of(truth.begin(), truth.end(), [&](const acf::Detector::Detection& kept) {
+                return overlap(kept.roi, bb.roi) > 0.5;
+            }))
+        {
+            truth.push_back(bb);
+        }
+    }
+
+    ASSERT_EQ(bbs.size(), truth.size());
+    for (int i = 0; i < bbs.size(); i++)
+    {
+        ASSERT_EQ(bbs[i].roi, truth[i].roi);
+        ASSERT_EQ(bbs[i].score, truth[i].score);
+    }
+}
+
+// With maxn the candidates are split recursively, which can change (but not lose) results:
+TEST(ACFNmsTest, MaxSplit)
+{
+    std::vector<cv::Rect> objects;
+    const auto candidates = createCandidates(4, 50, objects);
+
+    acf::Detector detector;
+    acf::Detector::Options::Nms pNms;
+    pNms.type = { "type", std::string("max") };
+    pNms.maxn = { "maxn", 64.0 };
+
+    acf::Detector::DetectionVec bbs;
+    detector.bbNms(candidates, pNms, bbs);
+    ASSERT_LT(bbs.size(), candidates.size() / 10);
+    for (const auto& object : objects)
+    {
+        ASSERT_TRUE(std::any_of(bbs.begin(), bbs.end(), [&](const acf::Detector::Detection& bb) {
+            return overlap(bb.roi, object) > 0.5;
+        }));
+    }
+}
+
+// Compare 'ms', 'cover' and 'maxg' on the same large candidate set (as seen with a low cascThr),
+// with the timings reported as test properties (e.g., bbNms_ms_us in --gtest_output=xml):
+TEST(ACFNmsTest, MeanShiftBenchmark)
+{
+    std::vector<cv::Rect> objects;
+    const auto candidates = createCandidates(10, 100, objects);
+
+    acf::Detector detector;
+    for (const auto& type : { "maxg", "ms", "cover" })
+    {
+        acf::Detector::Options::Nms pNms;
+        pNms.type = { "type", std::string(type) };
+
+        acf::Detector::DetectionVec bbs;
+        const auto tic = std::chrono::high_resolution_clock::now();
+        detector.bbNms(candidates, pNms, bbs);
+        const auto toc = std::chrono::high_resolution_clock::now();
+        RecordProperty(std::string("bbNms_") + type + "_us", int(std::chrono::duration_cast<std::chrono::microseconds>(toc - tic).count()));
+
+        // Each object should be found and the clusters should be collapsed:
+        ASSERT_LT(bbs.size(), candidates.size() / 10);
+        for (const auto& object : objects)
+        {
+            ASSERT_TRUE(std::any_of(bbs.begin(), bbs.end(), [&](const acf::Detector::Detection& bb) {
+                return overlap(bb.roi, object) > 0.5;
+            }));
+        }
+    }
+}
+
 #if defined(ACF_DO_GPU)
 TEST_F(ACFTest, ACFPyramidGPU10)
 {
@@ -589,10 +1309,26 @@ TEST_F(ACFTest, ACFCaltechDetector)
 {
     testPedestrianDetector(acfCaltechDetectorFilename, acfPedestrianImageFilename);
 }
+
+TEST_F(ACFTest, ACFInriaDetectorUint8)
+{
+    testPedestrianDetectorUint8(acfInriaDetectorFilename, acfPedestrianImageFilename);
+}
+
+TEST_F(ACFTest, ACFCaltechDetectorUint8)
+{
+    testPedestrianDetectorUint8(acfCaltechDetectorFilename, acfPedestrianImageFilename);
+}
 #endif // defined(ACF_SERIALIZE_WITH_CVMATIO)
 
 // ### utility ###
 
+static double overlap(const cv::Rect& a, const cv::Rect& b)
+{
+    const double o = (a & b).area();
+    return o / (a.area() + b.area() - o);
+}
+
 // http://stackoverflow.com/a/32647694
 static bool isEqual(const cv::Mat& a, const cv::Mat& b)
 {